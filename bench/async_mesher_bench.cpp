@@ -0,0 +1,84 @@
+// chunk meshing on the render thread against meshing on the task scheduler : chunks meshed per second
+
+// vulkan base
+#include "mesher/async_chunk_mesher.hpp"
+#include "job/task_scheduler.hpp"
+#include "bench_utils.hpp"
+
+// std
+#include <cstdlib>
+
+static const int Iterations = 20;
+
+static double meshSerial(const World& world, ChunkMesher::Type type)
+{
+	ChunkMeshData mesh;
+	mesh.vertexFormat = VertexFormat::Packed;
+
+	BenchTimer timer;
+	for (int iteration = 0; iteration < Iterations; iteration++)
+	{
+		for (int chunkIndex = 0; chunkIndex < BenchChunkCount; chunkIndex++)
+		{
+			mesh.clear();
+			ChunkMesher::generate(type, world, getBenchChunkCoord(chunkIndex), mesh);
+		}
+	}
+	return timer.elapsedMs();
+}
+
+// the snapshots are taken on this thread like the render system does, results are collected at the end
+static double meshAsync(const World& world, ChunkMesher::Type type, TaskScheduler& taskScheduler, size_t& resultCount, uint32_t& snapshotCount)
+{
+	AsyncChunkMesher asyncMesher{ taskScheduler };
+	std::vector<AsyncChunkMesher::Result> results;
+
+	BenchTimer timer;
+	for (int iteration = 0; iteration < Iterations; iteration++)
+	{
+		for (int chunkIndex = 0; chunkIndex < BenchChunkCount; chunkIndex++)
+			asyncMesher.submit(type, world, getBenchChunkCoord(chunkIndex), VertexFormat::Packed);
+	}
+	asyncMesher.wait();
+	asyncMesher.collect(results);
+	double ms = timer.elapsedMs();
+
+	resultCount = results.size();
+	snapshotCount = asyncMesher.getSnapshotCount();
+	return ms;
+}
+
+int main()
+{
+	const ChunkMesher::Type type = ChunkMesher::Type::binary;
+	TaskScheduler taskScheduler;
+	bool allMeshed = true;
+
+	size_t chunkCount = Iterations * BenchChunkCount;
+	std::cout << ChunkMesher::getTypeName(type) << " mesher, " << chunkCount << " chunks, " << taskScheduler.getThreadCount() << " worker threads" << std::endl;
+
+	for (BenchFill fill : { BenchFill::random, BenchFill::solid, BenchFill::terrain })
+	{
+		World world{};
+		fillWorld(world, fill);
+
+		size_t resultCount = 0;
+		uint32_t snapshotCount = 0;
+		double serialMs = meshSerial(world, type);
+		double asyncMs = meshAsync(world, type, taskScheduler, resultCount, snapshotCount);
+
+		std::cout << std::left << std::setw(8) << getFillName(fill) << std::right << std::fixed << std::setprecision(0)
+			<< "  serial " << std::setw(8) << chunkCount * 1000.0 / serialMs << " chunks/s"
+			<< "  jobs " << std::setw(8) << chunkCount * 1000.0 / asyncMs << " chunks/s"
+			<< "  x" << std::setprecision(1) << serialMs / asyncMs
+			<< "  (" << snapshotCount << " snapshots allocated)" << std::endl;
+
+		if (resultCount != chunkCount)
+		{
+			std::cout << "  only " << resultCount << " meshes came back from the workers" << std::endl;
+			allMeshed = false;
+		}
+	}
+
+	return allMeshed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,138 @@
+#pragma once
+
+// vulkan base
+#include "model/voxel.hpp"
+#include "mesher/chunk_mesher.hpp"
+
+// std
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <random>
+#include <string>
+#include <tuple>
+
+// small helpers shared by the cpu benchmarks
+
+class BenchTimer
+{
+public:
+	BenchTimer() : start(std::chrono::high_resolution_clock::now()) {}
+
+	double elapsedMs() const
+	{
+		return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	}
+
+private:
+	std::chrono::high_resolution_clock::time_point start;
+};
+
+enum class BenchFill
+{
+	random,
+	solid,
+	terrain
+};
+
+inline const char* getFillName(BenchFill fill)
+{
+	switch (fill)
+	{
+	case BenchFill::random: return "random";
+	case BenchFill::solid: return "solid";
+	case BenchFill::terrain: return "terrain";
+	}
+	return "";
+}
+
+// voxel of a world position for the given fill, deterministic for a given seed
+inline Voxel getFillVoxel(BenchFill fill, glm::ivec3 position, std::mt19937& rng)
+{
+	switch (fill)
+	{
+	case BenchFill::random:
+		return Voxel(rng() % 2 ? (uint16_t)Voxel::Type::stone : (uint16_t)Voxel::Type::air);
+
+	case BenchFill::solid:
+		return Voxel((uint16_t)Voxel::Type::stone);
+
+	case BenchFill::terrain:
+	{
+		// rolling hills : stone, a few layers of dirt and grass on top
+		float height = 24.0f + 8.0f * std::sin(position.x * 0.11f) + 6.0f * std::cos(position.z * 0.07f) + 3.0f * std::sin((position.x + position.z) * 0.23f);
+		int surface = static_cast<int>(height);
+
+		if (position.y > surface)
+			return Voxel((uint16_t)Voxel::Type::air);
+		if (position.y == surface)
+			return Voxel((uint16_t)Voxel::Type::grass);
+		if (position.y > surface - 4)
+			return Voxel((uint16_t)Voxel::Type::dirt);
+		return Voxel((uint16_t)Voxel::Type::stone);
+	}
+	}
+	return Voxel((uint16_t)Voxel::Type::air);
+}
+
+inline void fillChunk(Chunk& chunk, glm::ivec3 chunkCoord, BenchFill fill, std::mt19937& rng)
+{
+	for (int z = 0; z < Chunk::ChunkSize; z++)
+		for (int y = 0; y < Chunk::ChunkSize; y++)
+			for (int x = 0; x < Chunk::ChunkSize; x++)
+				chunk.setVoxel(x, y, z, getFillVoxel(fill, chunkCoord * Chunk::ChunkSize + glm::ivec3(x, y, z), rng));
+}
+
+// the mesher benches work on a small block of chunks at the origin
+static const int BenchWorldSize = 2;
+static const int BenchChunkCount = BenchWorldSize * BenchWorldSize * BenchWorldSize;
+
+inline glm::ivec3 getBenchChunkCoord(int chunkIndex)
+{
+	return glm::ivec3(chunkIndex % BenchWorldSize, (chunkIndex / BenchWorldSize) % BenchWorldSize, chunkIndex / (BenchWorldSize * BenchWorldSize));
+}
+
+// create and load the bench chunks, without going through the world stages
+inline void fillWorld(World& world, BenchFill fill, unsigned int seed = 1337)
+{
+	std::mt19937 rng(seed);
+	for (int chunkIndex = 0; chunkIndex < BenchChunkCount; chunkIndex++)
+	{
+		glm::ivec3 chunkCoord = getBenchChunkCoord(chunkIndex);
+		Chunk& chunk = world.chunks[world.createChunk(chunkCoord)];
+		fillChunk(chunk, chunkCoord, fill, rng);
+		chunk.load();
+	}
+}
+
+// unit squares covered by the quads of a mesh, keyed by (normal axis, cell position on the face plane)
+// a square covered twice counts twice so overlapping quads are caught too
+using Surface = std::map<std::tuple<int, int, int, int>, int>;
+
+inline Surface collectSurface(const ChunkMeshData& mesh)
+{
+	Surface surface;
+	for (size_t quad = 0; quad + 3 < mesh.vertices.size(); quad += 4)
+	{
+		glm::vec3 minCorner = mesh.vertices[quad].position;
+		glm::vec3 maxCorner = mesh.vertices[quad].position;
+		for (size_t corner = 1; corner < 4; corner++)
+		{
+			minCorner = glm::min(minCorner, mesh.vertices[quad + corner].position);
+			maxCorner = glm::max(maxCorner, mesh.vertices[quad + corner].position);
+		}
+
+		int axis = minCorner.x == maxCorner.x ? 0 : (minCorner.y == maxCorner.y ? 1 : 2);
+		glm::ivec3 cell(minCorner);
+		glm::ivec3 end(maxCorner);
+		end[axis] = cell[axis] + 1;
+
+		for (int z = cell.z; z < end.z; z++)
+			for (int y = cell.y; y < end.y; y++)
+				for (int x = cell.x; x < end.x; x++)
+					surface[std::make_tuple(axis, x, y, z)]++;
+	}
+	return surface;
+}
@@ -0,0 +1,73 @@
+// binary greedy mesher against the mask greedy mesher : time per chunk in microseconds
+
+// vulkan base
+#include "mesher/chunk_mesher.hpp"
+#include "bench_utils.hpp"
+
+// std
+#include <cstdlib>
+
+static const int Iterations = 50;
+
+static double timeMesher(ChunkMesher::Type type, const World& world, size_t& quadCount)
+{
+	ChunkMeshData mesh;
+	quadCount = 0;
+
+	BenchTimer timer;
+	for (int iteration = 0; iteration < Iterations; iteration++)
+	{
+		for (int chunkIndex = 0; chunkIndex < BenchChunkCount; chunkIndex++)
+		{
+			mesh.clear();
+			ChunkMesher::generate(type, world, getBenchChunkCoord(chunkIndex), mesh);
+			quadCount += mesh.vertices.size() / 4;
+		}
+	}
+
+	size_t runs = Iterations * BenchChunkCount;
+	quadCount /= runs;
+	return timer.elapsedMs() * 1000.0 / runs;
+}
+
+int main()
+{
+	bool surfaceMatches = true;
+
+	std::cout << "chunk size " << Chunk::ChunkSize << ", averaged over " << Iterations << " runs of " << BenchChunkCount << " chunks" << std::endl;
+
+	for (BenchFill fill : { BenchFill::random, BenchFill::solid, BenchFill::terrain })
+	{
+		World world{};
+		fillWorld(world, fill);
+
+		size_t greedyQuads = 0;
+		size_t binaryQuads = 0;
+		double greedyUs = timeMesher(ChunkMesher::Type::greedy, world, greedyQuads);
+		double binaryUs = timeMesher(ChunkMesher::Type::binary, world, binaryQuads);
+
+		std::cout << std::left << std::setw(8) << getFillName(fill) << std::right << std::fixed << std::setprecision(1)
+			<< "  greedy " << std::setw(9) << greedyUs << " us (" << greedyQuads << " quads)"
+			<< "  binary " << std::setw(9) << binaryUs << " us (" << binaryQuads << " quads)"
+			<< "  x" << std::setprecision(1) << greedyUs / binaryUs << std::endl;
+
+		// same output contract : the binary mesh covers the same surface as the culled one
+		ChunkMeshData culled;
+		ChunkMeshData binary;
+		for (int chunkIndex = 0; chunkIndex < BenchChunkCount; chunkIndex++)
+		{
+			culled.clear();
+			binary.clear();
+			ChunkMesher::generate(ChunkMesher::Type::culled, world, getBenchChunkCoord(chunkIndex), culled);
+			ChunkMesher::generate(ChunkMesher::Type::binary, world, getBenchChunkCoord(chunkIndex), binary);
+
+			if (collectSurface(culled) != collectSurface(binary))
+			{
+				std::cout << "  binary surface DOES NOT match the culled surface in chunk " << chunkIndex << std::endl;
+				surfaceMatches = false;
+			}
+		}
+	}
+
+	return surfaceMatches ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,169 @@
+// chunk lookup cost : the open addressing chunk map of the sparse world against a dense array of handles
+// the dense array is what the fixed size world used, an index computed from the coordinate
+
+// vulkan base
+#include "model/chunk_map.hpp"
+#include "bench_utils.hpp"
+
+// std
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+static const int LookupCount = 4000000;
+
+// handles of a cube of size chunks centered on the origin, InvalidChunkHandle outside
+class DenseChunkArray
+{
+public:
+	explicit DenseChunkArray(int size) : size(size), handles(size * size * size, InvalidChunkHandle) {}
+
+	void insert(glm::ivec3 coord, ChunkHandle handle) { handles[getIndex(coord)] = handle; }
+
+	ChunkHandle find(glm::ivec3 coord) const
+	{
+		int index = getIndex(coord);
+		return index < 0 ? InvalidChunkHandle : handles[index];
+	}
+
+private:
+	int size;
+	std::vector<ChunkHandle> handles;
+
+	int getIndex(glm::ivec3 coord) const
+	{
+		glm::ivec3 position = coord + glm::ivec3(size / 2);
+		if (position.x < 0 || position.y < 0 || position.z < 0 || position.x >= size || position.y >= size || position.z >= size)
+			return -1;
+
+		return position.x + size * (position.y + size * position.z);
+	}
+};
+
+static std::vector<glm::ivec3> getCubeCoords(int size)
+{
+	std::vector<glm::ivec3> coords;
+	for (int z = 0; z < size; z++)
+		for (int y = 0; y < size; y++)
+			for (int x = 0; x < size; x++)
+				coords.push_back(glm::ivec3(x, y, z) - glm::ivec3(size / 2));
+	return coords;
+}
+
+// random coordinates, a quarter of them just outside of the cube
+static std::vector<glm::ivec3> getLookupCoords(int size)
+{
+	std::mt19937 rng(1337);
+	std::uniform_int_distribution<int> inside(-size / 2, size - size / 2 - 1);
+	std::uniform_int_distribution<int> around(-size / 2 - size / 4, size - size / 2 - 1 + size / 4);
+
+	std::vector<glm::ivec3> coords(LookupCount / 8);
+	for (size_t i = 0; i < coords.size(); i++)
+	{
+		auto& distribution = i % 4 == 0 ? around : inside;
+		coords[i] = glm::ivec3(distribution(rng), distribution(rng), distribution(rng));
+	}
+	return coords;
+}
+
+struct LookupResult
+{
+	double ns = 0.0;
+	uint64_t checksum = 0;
+};
+
+template<typename Lookup>
+static LookupResult benchLookup(const Lookup& lookup, const std::vector<glm::ivec3>& coords)
+{
+	LookupResult result{};
+	int runs = LookupCount / static_cast<int>(coords.size());
+
+	BenchTimer timer;
+	for (int run = 0; run < runs; run++)
+		for (const glm::ivec3& coord : coords)
+			result.checksum += lookup.find(coord);
+	result.ns = timer.elapsedMs() * 1e6 / (runs * coords.size());
+	return result;
+}
+
+// the 6 neighbours of every chunk, the access pattern of the snapshots and of the border updates
+template<typename Lookup>
+static LookupResult benchNeighbours(const Lookup& lookup, const std::vector<glm::ivec3>& chunkCoords)
+{
+	const glm::ivec3 offsets[6] = { { 1, 0, 0 }, { -1, 0, 0 }, { 0, 1, 0 }, { 0, -1, 0 }, { 0, 0, 1 }, { 0, 0, -1 } };
+
+	LookupResult result{};
+	int runs = std::max(1, LookupCount / static_cast<int>(chunkCoords.size() * 6));
+
+	BenchTimer timer;
+	for (int run = 0; run < runs; run++)
+		for (const glm::ivec3& coord : chunkCoords)
+			for (const glm::ivec3& offset : offsets)
+				result.checksum += lookup.find(coord + offset);
+	result.ns = timer.elapsedMs() * 1e6 / (runs * chunkCoords.size() * 6);
+	return result;
+}
+
+// erase every other chunk then check that all the lookups still agree with the dense array
+static bool checkErase(ChunkMap& map, DenseChunkArray& dense, const std::vector<glm::ivec3>& chunkCoords)
+{
+	for (size_t i = 0; i < chunkCoords.size(); i += 2)
+	{
+		if (!map.erase(chunkCoords[i]))
+			return false;
+		dense.insert(chunkCoords[i], InvalidChunkHandle);
+	}
+
+	for (const glm::ivec3& coord : chunkCoords)
+	{
+		if (map.find(coord) != dense.find(coord))
+			return false;
+	}
+	return map.size() == chunkCoords.size() / 2;
+}
+
+int main()
+{
+	bool isConsistent = true;
+
+	for (int size : { 8, 16, 32 })
+	{
+		std::vector<glm::ivec3> chunkCoords = getCubeCoords(size);
+		std::vector<glm::ivec3> lookupCoords = getLookupCoords(size);
+
+		DenseChunkArray dense(size);
+		ChunkMap map;
+		for (size_t i = 0; i < chunkCoords.size(); i++)
+		{
+			dense.insert(chunkCoords[i], static_cast<ChunkHandle>(i));
+			map.insert(chunkCoords[i], static_cast<ChunkHandle>(i));
+		}
+
+		std::cout << size << "^3 chunks, map of " << map.capacity() << " slots ("
+			<< map.capacity() * (sizeof(glm::ivec3) + sizeof(ChunkHandle)) / 1024 << " KB)" << std::endl;
+
+		auto print = [&](const char* name, const LookupResult& denseResult, const LookupResult& mapResult) {
+			std::cout << "  " << std::left << std::setw(12) << name << std::right << std::fixed << std::setprecision(2)
+				<< "dense " << std::setw(6) << denseResult.ns << " ns"
+				<< "  map " << std::setw(6) << mapResult.ns << " ns"
+				<< "  x" << std::setprecision(1) << mapResult.ns / denseResult.ns << std::endl;
+
+			if (denseResult.checksum != mapResult.checksum)
+			{
+				std::cout << "  " << name << " lookups DO NOT match" << std::endl;
+				isConsistent = false;
+			}
+		};
+
+		print("random", benchLookup(dense, lookupCoords), benchLookup(map, lookupCoords));
+		print("neighbours", benchNeighbours(dense, chunkCoords), benchNeighbours(map, chunkCoords));
+
+		if (!checkErase(map, dense, chunkCoords))
+		{
+			std::cout << "  lookups after erase DO NOT match" << std::endl;
+			isConsistent = false;
+		}
+	}
+
+	return isConsistent ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,202 @@
+// cost of the chunk size : the same block of terrain cut in chunks of the size this bench is built with
+// the build makes chunk_size_bench_16, _32 and _64, run them side by side to pick the size
+// edits are measured re-meshing the whole chunk, then only the dirty sections
+
+// vulkan base
+#include "bench_utils.hpp"
+
+// std
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+// voxels of the block along each axis, a multiple of every chunk size
+static const glm::ivec3 RegionSize(256, 64, 256);
+static const int Runs = 4;
+static const int EditCount = 64;
+
+// keeps the results from being optimized away
+static volatile uint64_t readSink = 0;
+
+int main()
+{
+	const int size = Chunk::ChunkSize;
+	const glm::ivec3 chunkCount = RegionSize / size;
+	const uint32_t totalChunkCount = chunkCount.x * chunkCount.y * chunkCount.z;
+	const double voxelCount = (double)RegionSize.x * RegionSize.y * RegionSize.z;
+
+	std::vector<glm::ivec3> chunkCoords;
+	for (int z = 0; z < chunkCount.z; z++)
+		for (int y = 0; y < chunkCount.y; y++)
+			for (int x = 0; x < chunkCount.x; x++)
+				chunkCoords.push_back(glm::ivec3(x, y, z));
+
+	// generate and set the chunks up like the load and setup stages do
+	World world;
+	std::mt19937 rng(1337);
+	BenchTimer generateTimer;
+	for (const glm::ivec3& chunkCoord : chunkCoords)
+	{
+		Chunk& chunk = world.chunks[world.createChunk(chunkCoord)];
+		fillChunk(chunk, chunkCoord, BenchFill::terrain, rng);
+		chunk.load();
+		chunk.setup();
+	}
+	double generateMs = generateTimer.elapsedMs();
+
+	size_t memoryBytes = 0;
+	uint32_t renderedCount = 0;
+	for (const glm::ivec3& chunkCoord : chunkCoords)
+	{
+		const Chunk* chunk = world.getChunk(chunkCoord);
+		memoryBytes += chunk->voxels.getMemoryUsage() + sizeof(Chunk);
+		renderedCount += chunk->shouldRender ? 1 : 0;
+	}
+
+	std::cout << "chunk size " << size << ", " << RegionSize.x << "x" << RegionSize.y << "x" << RegionSize.z << " voxels of terrain in "
+		<< totalChunkCount << " chunks" << std::endl;
+	std::cout << std::fixed << std::setprecision(1)
+		<< "  generate " << generateMs << " ms, " << memoryBytes / 1024.0 << " KB of voxels ("
+		<< memoryBytes * 8.0 / voxelCount << " bits/voxel)" << std::endl;
+
+	// the whole block meshed, every chunk with a mesh is one draw
+	uint32_t greedyQuadCount = 0;
+	uint32_t binaryQuadCount = 0;
+	for (ChunkMesher::Type type : { ChunkMesher::Type::culled, ChunkMesher::Type::greedy, ChunkMesher::Type::binary })
+	{
+		ChunkMeshData mesh;
+		uint32_t quadCount = 0;
+		uint32_t drawCount = 0;
+		BenchTimer timer;
+		for (int run = 0; run < Runs; run++)
+		{
+			for (const glm::ivec3& chunkCoord : chunkCoords)
+			{
+				mesh.clear();
+				ChunkMesher::generate(type, world, chunkCoord, mesh);
+				if (run == 0)
+				{
+					quadCount += mesh.getQuadCount();
+					drawCount += mesh.getQuadCount() > 0 ? 1 : 0;
+				}
+			}
+		}
+		double ms = timer.elapsedMs() / Runs;
+
+		std::cout << "  " << std::left << std::setw(8) << ChunkMesher::getTypeName(type) << std::right << std::setprecision(1)
+			<< std::setw(9) << ms << " ms" << std::setprecision(2) << std::setw(8) << ms * 1e6 / voxelCount << " ns/voxel"
+			<< std::setprecision(1) << std::setw(10) << ms * 1000.0 / totalChunkCount << " us/chunk"
+			<< std::setw(9) << quadCount << " quads" << std::setw(6) << drawCount << " draws" << std::endl;
+
+		if (type == ChunkMesher::Type::greedy)
+			greedyQuadCount = quadCount;
+		if (type == ChunkMesher::Type::binary)
+			binaryQuadCount = quadCount;
+	}
+
+	// one voxel edited on the surface, the chunk re-meshed : what the player waits for after breaking a block
+	ChunkMeshData mesh;
+	BenchTimer editTimer;
+	for (int edit = 0; edit < EditCount; edit++)
+	{
+		glm::ivec3 position(rng() % RegionSize.x, 0, rng() % RegionSize.z);
+		while (position.y + 1 < RegionSize.y && world.getVoxel(position + glm::ivec3(0, 1, 0)).isSolid())
+			position.y++;
+
+		world.setVoxel(position, Voxel((uint16_t)Voxel::Type::air));
+		mesh.clear();
+		ChunkMesher::generate(ChunkMesher::Type::binary, world, glm::ivec3(position.x / size, position.y / size, position.z / size), mesh);
+		readSink = mesh.getQuadCount();
+	}
+	std::cout << std::setprecision(1) << "  edit and re-mesh " << editTimer.elapsedMs() * 1000.0 / EditCount << " us" << std::endl;
+
+	// the same kind of edits with the meshes kept section by section, like the renderer does :
+	// only the sections an edit dirtied, in its chunk and across the borders, are meshed again
+	auto getChunkIndex = [&](glm::ivec3 chunkCoord) { return chunkCoord.x + chunkCount.x * (chunkCoord.y + chunkCount.y * chunkCoord.z); };
+	std::vector<std::vector<ChunkMeshData>> sectionMeshes(totalChunkCount, std::vector<ChunkMeshData>(Chunk::SectionCount));
+	ChunkSnapshot snapshot;
+	uint32_t remeshedSectionCount = 0;
+	auto meshDirtySections = [&](glm::ivec3 chunkCoord) {
+		Chunk* chunk = world.getChunk(chunkCoord);
+		uint64_t sectionMask = chunk != nullptr ? chunk->takeDirtySections() : 0;
+		if (sectionMask == 0)
+			return;
+
+		glm::ivec3 min, max;
+		Chunk::getSectionBounds(sectionMask, min, max);
+		snapshot.capture(world, chunkCoord, min, max);
+		for (int section = 0; section < Chunk::SectionCount; section++)
+		{
+			if ((sectionMask & (1ull << section)) == 0)
+				continue;
+
+			ChunkMeshData& sectionMesh = sectionMeshes[getChunkIndex(chunkCoord)][section];
+			sectionMesh.clear();
+			ChunkMesher::generate(ChunkMesher::Type::binary, snapshot, sectionMesh, Chunk::getSectionOrigin(section), Chunk::SectionSize);
+			remeshedSectionCount++;
+		}
+	};
+
+	for (const glm::ivec3& chunkCoord : chunkCoords)
+	{
+		world.getChunk(chunkCoord)->markAllDirty();
+		meshDirtySections(chunkCoord);
+	}
+
+	remeshedSectionCount = 0;
+	BenchTimer sectionTimer;
+	for (int edit = 0; edit < EditCount; edit++)
+	{
+		glm::ivec3 position(rng() % RegionSize.x, 0, rng() % RegionSize.z);
+		while (position.y + 1 < RegionSize.y && world.getVoxel(position + glm::ivec3(0, 1, 0)).isSolid())
+			position.y++;
+
+		world.setVoxel(position, Voxel((uint16_t)Voxel::Type::air));
+
+		glm::ivec3 chunkCoord(position.x / size, position.y / size, position.z / size);
+		meshDirtySections(chunkCoord);
+		for (int axis = 0; axis < 3; axis++)
+		{
+			for (int direction : { -1, 1 })
+			{
+				glm::ivec3 neighbour = chunkCoord;
+				neighbour[axis] += direction;
+				meshDirtySections(neighbour);
+			}
+		}
+	}
+	std::cout << std::setprecision(1) << "  edit and re-mesh sections " << sectionTimer.elapsedMs() * 1000.0 / EditCount << " us, "
+		<< (double)remeshedSectionCount / EditCount << " sections of " << Chunk::SectionSize << "^3 per edit" << std::endl;
+
+	// the patched sections must cover the surface of a fresh mesh of every chunk, or an edit missed a dirty section
+	bool isSectionSurfaceValid = true;
+	for (const glm::ivec3& chunkCoord : chunkCoords)
+	{
+		Surface sectionSurface;
+		for (const ChunkMeshData& sectionMesh : sectionMeshes[getChunkIndex(chunkCoord)])
+			for (const auto& cell : collectSurface(sectionMesh))
+				sectionSurface[cell.first] += cell.second;
+
+		mesh.clear();
+		ChunkMesher::generate(ChunkMesher::Type::binary, world, chunkCoord, mesh);
+		if (sectionSurface != collectSurface(mesh))
+			isSectionSurfaceValid = false;
+	}
+
+	std::cout << "  " << renderedCount << " chunks with solid voxels, " << std::setprecision(1)
+		<< (double)binaryQuadCount / (RegionSize.x * RegionSize.z) << " quads per surface column" << std::endl;
+
+	// both merge the same faces the same way, whatever the chunk size
+	if (binaryQuadCount == 0 || binaryQuadCount != greedyQuadCount)
+	{
+		std::cout << "  greedy and binary meshes DO NOT match" << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	if (!isSectionSurfaceValid)
+	{
+		std::cout << "  section meshes DO NOT match the chunk meshes" << std::endl;
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
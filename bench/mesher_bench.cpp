@@ -0,0 +1,103 @@
+// compare the chunk meshers on the cpu : geometry size and meshing time per chunk
+
+// vulkan base
+#include "mesher/chunk_mesher.hpp"
+#include "bench_utils.hpp"
+
+// std
+#include <cstdlib>
+#include <functional>
+#include <string>
+
+static const int Iterations = 10;
+
+struct MesherResult
+{
+	size_t vertices = 0;
+	size_t indices = 0;
+	double ms = 0.0;
+};
+
+static MesherResult runMesher(const std::function<void(glm::ivec3, ChunkMeshData&)>& mesher)
+{
+	MesherResult result{};
+	ChunkMeshData mesh;
+
+	BenchTimer timer;
+	for (int iteration = 0; iteration < Iterations; iteration++)
+	{
+		for (int chunkIndex = 0; chunkIndex < BenchChunkCount; chunkIndex++)
+		{
+			mesh.clear();
+			mesher(getBenchChunkCoord(chunkIndex), mesh);
+
+			if (iteration == 0)
+			{
+				result.vertices += mesh.vertices.size();
+				result.indices += mesh.getIndexCount();
+			}
+		}
+	}
+
+	size_t chunkCount = BenchChunkCount;
+	result.ms = timer.elapsedMs() / (Iterations * chunkCount);
+	result.vertices /= chunkCount;
+	result.indices /= chunkCount;
+	return result;
+}
+
+static void printResult(const std::string& name, const MesherResult& result)
+{
+	std::cout << "  " << std::left << std::setw(10) << name
+		<< std::right << std::setw(10) << result.vertices << " vertices"
+		<< std::setw(10) << result.indices << " indices"
+		<< std::setw(12) << std::fixed << std::setprecision(3) << result.ms << " ms/chunk"
+		<< std::setw(10) << std::setprecision(1) << result.vertices * sizeof(Vertex) / 1024.0 << " KB vertices"
+		<< " (" << result.vertices * sizeof(PackedVertex) / 1024.0 << " KB packed)" << std::endl;
+}
+
+// the greedy mesh must cover exactly the visible surface found by the culled mesher
+static bool checkGreedySurface(const World& world)
+{
+	ChunkMeshData culled;
+	ChunkMeshData greedy;
+	for (int chunkIndex = 0; chunkIndex < BenchChunkCount; chunkIndex++)
+	{
+		culled.clear();
+		greedy.clear();
+		ChunkMesher::generate(ChunkMesher::Type::culled, world, getBenchChunkCoord(chunkIndex), culled);
+		ChunkMesher::generate(ChunkMesher::Type::greedy, world, getBenchChunkCoord(chunkIndex), greedy);
+
+		if (collectSurface(culled) != collectSurface(greedy))
+			return false;
+	}
+	return true;
+}
+
+int main()
+{
+	bool surfaceMatches = true;
+
+	std::cout << "chunk size " << Chunk::ChunkSize << ", " << BenchChunkCount << " chunks, averaged over " << Iterations << " runs" << std::endl;
+
+	for (BenchFill fill : { BenchFill::random, BenchFill::solid, BenchFill::terrain })
+	{
+		World world{};
+		fillWorld(world, fill);
+
+		std::cout << getFillName(fill) << std::endl;
+
+		for (int type = 0; type < (int)ChunkMesher::Type::NUM_TYPES; type++)
+		{
+			printResult(ChunkMesher::getTypeName((ChunkMesher::Type)type), runMesher([&](glm::ivec3 chunkCoord, ChunkMeshData& mesh) {
+				ChunkMesher::generate((ChunkMesher::Type)type, world, chunkCoord, mesh);
+			}));
+		}
+
+		bool fillMatches = checkGreedySurface(world);
+		std::cout << "  greedy surface " << (fillMatches ? "matches" : "DOES NOT match") << " the culled surface" << std::endl;
+		surfaceMatches = surfaceMatches && fillMatches;
+	}
+
+	return surfaceMatches ? EXIT_SUCCESS : EXIT_FAILURE;
+}
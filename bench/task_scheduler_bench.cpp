@@ -0,0 +1,96 @@
+// scheduling overhead of the work stealing task scheduler : nanoseconds per empty task
+
+// vulkan base
+#include "job/task_scheduler.hpp"
+#include "bench_utils.hpp"
+
+// std
+#include <atomic>
+#include <cstdlib>
+
+static const int TaskCount = 100000;
+static const int ChainLength = 10000;
+static const int TreeDepth = 16;
+
+static std::atomic<int> executedCount{ 0 };
+
+// independent tasks submitted from the main thread, which helps while waiting
+static double benchIndependent(TaskScheduler& scheduler)
+{
+	BenchTimer timer;
+	for (int i = 0; i < TaskCount; i++)
+		scheduler.submit([]() { executedCount++; });
+	scheduler.waitAll();
+	return timer.elapsedMs() * 1e6 / TaskCount;
+}
+
+// the shape of a world stage : many tasks joined by one task depending on all of them
+static double benchFanIn(TaskScheduler& scheduler)
+{
+	std::vector<TaskScheduler::TaskHandle> tasks;
+	tasks.reserve(TaskCount);
+
+	BenchTimer timer;
+	for (int i = 0; i < TaskCount; i++)
+		tasks.push_back(scheduler.submit([]() { executedCount++; }));
+	scheduler.wait(scheduler.submit([]() { executedCount++; }, tasks));
+	return timer.elapsedMs() * 1e6 / (TaskCount + 1);
+}
+
+// every task depends on the previous one : cost of a dependency hop, nothing runs in parallel
+static double benchChain(TaskScheduler& scheduler)
+{
+	BenchTimer timer;
+	TaskScheduler::TaskHandle previous;
+	for (int i = 0; i < ChainLength; i++)
+		previous = scheduler.submit([]() { executedCount++; }, { previous });
+	scheduler.wait(previous);
+	return timer.elapsedMs() * 1e6 / ChainLength;
+}
+
+// tasks spawning their children from the workers : local deques and stealing
+static void spawnTree(TaskScheduler& scheduler, int depth)
+{
+	executedCount++;
+	if (depth == 0)
+		return;
+
+	scheduler.submit([&scheduler, depth]() { spawnTree(scheduler, depth - 1); });
+	scheduler.submit([&scheduler, depth]() { spawnTree(scheduler, depth - 1); });
+}
+
+static double benchNested(TaskScheduler& scheduler)
+{
+	const int treeTaskCount = (1 << (TreeDepth + 1)) - 1;
+
+	BenchTimer timer;
+	scheduler.submit([&scheduler]() { spawnTree(scheduler, TreeDepth); });
+	scheduler.waitAll();
+	return timer.elapsedMs() * 1e6 / treeTaskCount;
+}
+
+int main()
+{
+	TaskScheduler scheduler;
+	std::cout << scheduler.getThreadCount() << " worker threads, empty tasks" << std::endl;
+
+	int expectedCount = 0;
+	auto print = [&](const char* name, double ns, int taskCount) {
+		expectedCount += taskCount;
+		std::cout << "  " << std::left << std::setw(12) << name << std::right << std::fixed << std::setprecision(0)
+			<< std::setw(8) << ns << " ns/task" << std::endl;
+	};
+
+	print("independent", benchIndependent(scheduler), TaskCount);
+	print("fan-in", benchFanIn(scheduler), TaskCount + 1);
+	print("chain", benchChain(scheduler), ChainLength);
+	print("nested", benchNested(scheduler), (1 << (TreeDepth + 1)) - 1);
+
+	if (executedCount.load() != expectedCount)
+	{
+		std::cout << "  " << executedCount.load() << " tasks ran, " << expectedCount << " expected" << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
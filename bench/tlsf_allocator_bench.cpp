@@ -0,0 +1,244 @@
+// tlsf allocator of the device memory blocks against a first fit free list : chunk buffers of random sizes
+// allocated and freed in a 64 MB block the way streaming does, with the latency of both and the fragmentation
+// left behind, no device needed since the allocator only deals with offsets
+
+// vulkan base
+#include "bench_utils.hpp"
+#include "memory/tlsf_allocator.hpp"
+
+// std
+#include <algorithm>
+#include <cstdlib>
+#include <vector>
+
+static const uint64_t BlockSize = 64ull * 1024 * 1024;
+// the live allocations are kept around this share of the block
+static const double TargetUsage = 0.75;
+static const int ChurnCount = 200000;
+
+// first fit over the free ranges sorted by offset, what a simple sub-allocator does
+class FirstFitAllocator
+{
+public:
+	explicit FirstFitAllocator(uint64_t size) : size(size) { freeRanges[0] = size; }
+
+	bool allocate(uint64_t requestedSize, uint64_t alignment, uint64_t& offset)
+	{
+		for (auto it = freeRanges.begin(); it != freeRanges.end(); ++it)
+		{
+			uint64_t alignedOffset = (it->first + alignment - 1) & ~(alignment - 1);
+			if (alignedOffset + requestedSize > it->first + it->second)
+				continue;
+
+			uint64_t rangeOffset = it->first;
+			uint64_t rangeEnd = it->first + it->second;
+			freeRanges.erase(it);
+			if (alignedOffset > rangeOffset)
+				freeRanges[rangeOffset] = alignedOffset - rangeOffset;
+			if (alignedOffset + requestedSize < rangeEnd)
+				freeRanges[alignedOffset + requestedSize] = rangeEnd - alignedOffset - requestedSize;
+
+			offset = alignedOffset;
+			return true;
+		}
+		return false;
+	}
+
+	void free(uint64_t offset, uint64_t rangeSize)
+	{
+		auto it = freeRanges.emplace(offset, rangeSize).first;
+
+		auto next = std::next(it);
+		if (next != freeRanges.end() && it->first + it->second == next->first)
+		{
+			it->second += next->second;
+			freeRanges.erase(next);
+		}
+		if (it != freeRanges.begin())
+		{
+			auto previous = std::prev(it);
+			if (previous->first + previous->second == it->first)
+			{
+				previous->second += it->second;
+				freeRanges.erase(it);
+			}
+		}
+	}
+
+	uint64_t getLargestFreeRange() const
+	{
+		uint64_t largest = 0;
+		for (const auto& range : freeRanges)
+			largest = std::max(largest, range.second);
+		return largest;
+	}
+
+	uint64_t getFreeSize() const
+	{
+		uint64_t freeSize = 0;
+		for (const auto& range : freeRanges)
+			freeSize += range.second;
+		return freeSize;
+	}
+
+private:
+	uint64_t size;
+	std::map<uint64_t, uint64_t> freeRanges;
+};
+
+struct Request
+{
+	uint64_t size;
+	uint64_t alignment;
+};
+
+// chunk vertex buffers : mostly small surfaces, a few large ones, sizes spread on a log scale
+static Request getRequest(std::mt19937& rng)
+{
+	static const uint64_t Alignments[] = { 16, 64, 256, 4096 };
+	std::uniform_real_distribution<double> logSize(std::log2(4.0 * 1024), std::log2(256.0 * 1024));
+	return { static_cast<uint64_t>(std::exp2(logSize(rng))), Alignments[rng() % 4] };
+}
+
+struct BenchResult
+{
+	double allocateNs = 0.0;
+	double freeNs = 0.0;
+	double fragmentation = 0.0;
+	int failedCount = 0;
+};
+
+struct Live
+{
+	uint64_t offset;
+	uint64_t size;
+	uint64_t alignment;
+	TlsfAllocator::Allocation allocation;
+};
+
+// allocations are freed at random once the block is full enough, so free ranges end up everywhere
+template<typename Allocate, typename Free>
+static BenchResult churn(Allocate allocate, Free free, std::vector<Live>& live)
+{
+	std::mt19937 rng(1337);
+	BenchResult result;
+	uint64_t usedSize = 0;
+	double allocateMs = 0.0, freeMs = 0.0;
+	int allocateCount = 0, freeCount = 0;
+
+	for (int step = 0; step < ChurnCount; step++)
+	{
+		if (usedSize > BlockSize * TargetUsage && !live.empty())
+		{
+			size_t index = rng() % live.size();
+			std::swap(live[index], live.back());
+
+			BenchTimer timer;
+			free(live.back());
+			freeMs += timer.elapsedMs();
+			freeCount++;
+
+			usedSize -= live.back().size;
+			live.pop_back();
+			continue;
+		}
+
+		Request request = getRequest(rng);
+		Live allocation{ 0, request.size, request.alignment, {} };
+
+		BenchTimer timer;
+		bool isAllocated = allocate(allocation);
+		allocateMs += timer.elapsedMs();
+		allocateCount++;
+
+		if (!isAllocated)
+		{
+			// full : make room as streaming would by unloading chunks
+			result.failedCount++;
+			usedSize = BlockSize;
+			continue;
+		}
+
+		usedSize += request.size;
+		live.push_back(allocation);
+	}
+
+	result.allocateNs = allocateMs * 1e6 / std::max(allocateCount, 1);
+	result.freeNs = freeMs * 1e6 / std::max(freeCount, 1);
+	return result;
+}
+
+// the live ranges must be aligned and must not overlap
+static bool checkRanges(std::vector<Live> live)
+{
+	std::sort(live.begin(), live.end(), [](const Live& a, const Live& b) { return a.offset < b.offset; });
+	for (size_t index = 0; index < live.size(); index++)
+	{
+		if (live[index].offset % live[index].alignment != 0 || live[index].offset + live[index].size > BlockSize)
+			return false;
+		if (index > 0 && live[index - 1].offset + live[index - 1].size > live[index].offset)
+			return false;
+	}
+	return true;
+}
+
+static void printResult(const char* label, const BenchResult& result, size_t liveCount)
+{
+	std::cout << "  " << label << std::fixed << std::setprecision(1)
+		<< std::setw(9) << result.allocateNs << " ns/alloc" << std::setw(9) << result.freeNs << " ns/free"
+		<< std::setw(7) << result.fragmentation * 100.0 << "% fragmented" << std::setw(6) << result.failedCount << " failed"
+		<< std::setw(7) << liveCount << " live" << std::endl;
+}
+
+int main()
+{
+	std::cout << "block " << BlockSize / (1024 * 1024) << " MB, " << ChurnCount << " steps, 4 KB to 256 KB ranges, "
+		<< TargetUsage * 100.0 << "% used" << std::endl;
+
+	bool isValid = true;
+
+	// tlsf
+	TlsfAllocator tlsf(BlockSize);
+	std::vector<Live> tlsfLive;
+	BenchResult tlsfResult = churn(
+		[&](Live& live) {
+			if (!tlsf.allocate(live.size, live.alignment, live.allocation))
+				return false;
+			live.offset = live.allocation.offset;
+			return true;
+		},
+		[&](Live& live) { tlsf.free(live.allocation); },
+		tlsfLive);
+	tlsfResult.fragmentation = 1.0 - (double)tlsf.getLargestFreeRange() / (double)tlsf.getFreeSize();
+	printResult("tlsf      ", tlsfResult, tlsfLive.size());
+
+	if (!checkRanges(tlsfLive) || tlsf.getAllocationCount() != tlsfLive.size())
+	{
+		std::cout << "  tlsf ranges OVERLAP or are misaligned" << std::endl;
+		isValid = false;
+	}
+
+	// every range freed, the block is one free range again
+	for (Live& live : tlsfLive)
+		tlsf.free(live.allocation);
+	if (!tlsf.empty() || tlsf.getFreeRangeCount() != 1 || tlsf.getLargestFreeRange() != BlockSize)
+	{
+		std::cout << "  tlsf free ranges NOT MERGED, " << tlsf.getFreeRangeCount() << " left" << std::endl;
+		isValid = false;
+	}
+
+	// first fit
+	FirstFitAllocator firstFit(BlockSize);
+	std::vector<Live> firstFitLive;
+	BenchResult firstFitResult = churn(
+		[&](Live& live) { return firstFit.allocate(live.size, live.alignment, live.offset); },
+		[&](Live& live) { firstFit.free(live.offset, live.size); },
+		firstFitLive);
+	firstFitResult.fragmentation = 1.0 - (double)firstFit.getLargestFreeRange() / (double)firstFit.getFreeSize();
+	printResult("first fit ", firstFitResult, firstFitLive.size());
+
+	std::cout << "  x" << std::setprecision(2) << firstFitResult.allocateNs / tlsfResult.allocateNs << " alloc, x"
+		<< firstFitResult.freeNs / tlsfResult.freeNs << " free" << std::endl;
+
+	return isValid ? EXIT_SUCCESS : EXIT_FAILURE;
+}
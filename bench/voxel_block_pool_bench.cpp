@@ -0,0 +1,150 @@
+// voxel block pool against new and delete : threads churning chunk sized blocks, then chunks generated
+// and thrown away on the task scheduler the way streaming does, with the pool statistics
+
+// vulkan base
+#include "bench_utils.hpp"
+#include "job/task_scheduler.hpp"
+
+// std
+#include <array>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+static const int ChunksPerThread = 4000;
+// chunks alive at once on every thread, the oldest is freed when a new one is generated
+static const int LiveChunkCount = 64;
+static const int StreamRounds = 8;
+static const int StreamChunkCount = 256;
+
+// keeps the blocks from being optimized away
+static volatile uint64_t writeSink = 0;
+
+// the blocks a chunk goes through as its palette grows from 2 to 16 types : 1, 2 then 4 bits per voxel
+static uint32_t getWordCount(uint32_t bits)
+{
+	return Chunk::ChunkSize * Chunk::ChunkSize * Chunk::ChunkSize * bits / 64;
+}
+
+template<bool UsePool>
+static void churn(int chunkCount)
+{
+	std::array<uint64_t*, LiveChunkCount> live{};
+	const uint32_t finalWordCount = getWordCount(4);
+
+	for (int chunk = 0; chunk < chunkCount; chunk++)
+	{
+		uint64_t* block = nullptr;
+		for (uint32_t bits : { 1u, 2u, 4u })
+		{
+			uint64_t* grown = UsePool ? VoxelBlockPool::get().allocate(getWordCount(bits)) : new uint64_t[getWordCount(bits)];
+			grown[0] = bits;
+			if (block != nullptr)
+			{
+				if (UsePool)
+					VoxelBlockPool::get().free(block, getWordCount(bits / 2));
+				else
+					delete[] block;
+			}
+			block = grown;
+		}
+
+		uint64_t*& slot = live[chunk % LiveChunkCount];
+		if (slot != nullptr)
+		{
+			writeSink = writeSink + slot[0];
+			if (UsePool)
+				VoxelBlockPool::get().free(slot, finalWordCount);
+			else
+				delete[] slot;
+		}
+		slot = block;
+	}
+
+	for (uint64_t* block : live)
+	{
+		if (UsePool)
+			VoxelBlockPool::get().free(block, finalWordCount);
+		else
+			delete[] block;
+	}
+}
+
+template<bool UsePool>
+static double benchChurn(int threadCount)
+{
+	BenchTimer timer;
+	std::vector<std::thread> threads;
+	for (int thread = 0; thread < threadCount; thread++)
+		threads.emplace_back(churn<UsePool>, ChunksPerThread);
+	for (std::thread& thread : threads)
+		thread.join();
+
+	// three allocations per chunk
+	return timer.elapsedMs() * 1e6 / (threadCount * ChunksPerThread * 3.0);
+}
+
+static void printStats(const char* label, const VoxelBlockPool::Stats& stats)
+{
+	double hitRate = stats.allocations > 0 ? 100.0 * stats.threadCacheHits / stats.allocations : 0.0;
+	std::cout << "  " << label << std::fixed << std::setprecision(1)
+		<< std::setw(9) << stats.allocations << " allocs" << std::setw(9) << stats.frees << " frees"
+		<< std::setw(7) << hitRate << "% cache hits" << std::setw(6) << stats.systemAllocations << " from system"
+		<< std::setw(9) << stats.usedBytes / 1024.0 << " KB used" << std::setw(9) << stats.reservedBytes / 1024.0 << " KB reserved" << std::endl;
+}
+
+int main()
+{
+	std::cout << "chunk size " << Chunk::ChunkSize << ", " << ChunksPerThread << " chunks per thread, "
+		<< LiveChunkCount << " alive per thread" << std::endl;
+
+	for (int threadCount : { 1, 2, 4, 8 })
+	{
+		double heapNs = benchChurn<false>(threadCount);
+		double poolNs = benchChurn<true>(threadCount);
+		std::cout << "  " << threadCount << " threads" << std::fixed << std::setprecision(1)
+			<< "  new/delete " << std::setw(7) << heapNs << " ns/alloc" << "  pool " << std::setw(7) << poolNs << " ns/alloc"
+			<< "  x" << std::setprecision(2) << heapNs / poolNs << std::endl;
+	}
+	printStats("churn  ", VoxelBlockPool::get().getStats());
+
+	// chunks generated on the workers, compacted, then all thrown away for the next ones
+	TaskScheduler taskScheduler;
+	std::cout << "streaming " << StreamRounds << " rounds of " << StreamChunkCount << " chunks on "
+		<< taskScheduler.getThreadCount() << " worker threads" << std::endl;
+
+	VoxelBlockPool::Stats startStats = VoxelBlockPool::get().getStats();
+	BenchTimer streamTimer;
+	for (int round = 0; round < StreamRounds; round++)
+	{
+		std::vector<Chunk> chunks(StreamChunkCount);
+		for (int chunkIndex = 0; chunkIndex < StreamChunkCount; chunkIndex++)
+		{
+			Chunk* chunk = &chunks[chunkIndex];
+			chunk->coord = glm::ivec3(round * 16 + chunkIndex % 16, chunkIndex / 64, (chunkIndex / 16) % 4);
+			taskScheduler.submit([chunk]() {
+				std::mt19937 rng;
+				fillChunk(*chunk, chunk->coord, BenchFill::terrain, rng);
+				chunk->voxels.compact();
+			});
+		}
+		taskScheduler.waitAll();
+	}
+	double streamMs = streamTimer.elapsedMs();
+
+	VoxelBlockPool::Stats stats = VoxelBlockPool::get().getStats();
+	std::cout << std::fixed << std::setprecision(1) << "  " << streamMs * 1000.0 / (StreamRounds * StreamChunkCount) << " us/chunk, "
+		<< stats.systemAllocations - startStats.systemAllocations << " blocks taken from the system" << std::endl;
+	printStats("stream ", stats);
+
+	// every block is back in the pool once the chunks are gone
+	if (stats.allocations != stats.frees || stats.usedBytes != 0)
+	{
+		std::cout << "  blocks LEAKED" << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	VoxelBlockPool::get().trim();
+	printStats("trimmed", VoxelBlockPool::get().getStats());
+	return EXIT_SUCCESS;
+}
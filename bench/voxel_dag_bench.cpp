@@ -0,0 +1,240 @@
+// far storage of the world : memory of a square kilometer of generated terrain as plain voxels, as paletted
+// chunks and as a deduplicated voxel octree, cost of the octree queries, and chunks round tripping through it
+// one voxel is one meter
+
+// vulkan base
+#include "model/voxel_dag.hpp"
+#include "bench_utils.hpp"
+
+// std
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+static const int RegionSize = 32;   // chunk columns along x and z, 1024 m
+static const int RegionHeight = 3;  // chunks along y, stone below, the hills, then the sky
+static const int QueryCount = 2000000;
+static const int BoxRuns = 10;
+
+// keeps the reads from being optimized away
+static volatile uint64_t readSink = 0;
+
+static glm::ivec3 getRegionChunkCoord(int chunkIndex)
+{
+	return glm::ivec3(chunkIndex % RegionSize, (chunkIndex / RegionSize) % RegionHeight - 1, chunkIndex / (RegionSize * RegionHeight));
+}
+
+// terrain chunks, generated through a decoded buffer so that the setup does not dominate the bench
+static std::vector<Chunk> generateRegion()
+{
+	std::vector<Chunk> chunks(RegionSize * RegionSize * RegionHeight);
+	std::vector<Voxel> voxels(Chunk::ChunkSize * Chunk::ChunkSize * Chunk::ChunkSize);
+	std::mt19937 rng(1337);
+
+	for (size_t i = 0; i < chunks.size(); i++)
+	{
+		glm::ivec3 chunkCoord = getRegionChunkCoord(static_cast<int>(i));
+		for (int z = 0; z < Chunk::ChunkSize; z++)
+			for (int y = 0; y < Chunk::ChunkSize; y++)
+				for (int x = 0; x < Chunk::ChunkSize; x++)
+					voxels[Chunk::getVoxelIndex(x, y, z)] = getFillVoxel(BenchFill::terrain, chunkCoord * Chunk::ChunkSize + glm::ivec3(x, y, z), rng);
+
+		chunks[i].coord = chunkCoord;
+		chunks[i].voxels.encode(voxels.data());
+	}
+	return chunks;
+}
+
+// every stored chunk decodes back to its voxels, and point queries agree with the chunks
+static bool checkRoundTrip(const VoxelDag& dag, const std::vector<Chunk>& chunks)
+{
+	const uint32_t voxelCount = Chunk::ChunkSize * Chunk::ChunkSize * Chunk::ChunkSize;
+
+	std::vector<Voxel> expected(voxelCount);
+	std::vector<Voxel> loaded(voxelCount);
+	Chunk chunk;
+	for (const Chunk& source : chunks)
+	{
+		if (!dag.loadChunk(source.coord, chunk))
+			return false;
+
+		source.voxels.decode(expected.data());
+		chunk.voxels.decode(loaded.data());
+		for (uint32_t index = 0; index < voxelCount; index++)
+		{
+			if (expected[index].id != loaded[index].id)
+				return false;
+		}
+	}
+
+	std::mt19937 rng(7);
+	for (int query = 0; query < 100000; query++)
+	{
+		const Chunk& source = chunks[rng() % chunks.size()];
+		glm::ivec3 localPosition(rng() % Chunk::ChunkSize, rng() % Chunk::ChunkSize, rng() % Chunk::ChunkSize);
+		if (dag.getVoxel(source.coord * Chunk::ChunkSize + localPosition).id != source.getVoxel(localPosition.x, localPosition.y, localPosition.z).id)
+			return false;
+	}
+
+	return !dag.loadChunk(glm::ivec3(RegionSize, 0, 0), chunk) && !dag.getVoxel(glm::ivec3(-1)).isSolid();
+}
+
+// a voxel edited in the world is still there after its chunk went out of the visibility radius and came back
+static bool checkWorldFarStorage()
+{
+	const glm::ivec3 editPosition(5, 40, 7);
+	const glm::vec3 view(0.0f, 0.0f, 1.0f);
+	const Voxel sand((uint16_t)Voxel::Type::sand);
+
+	VoxelDag dag;
+	World world;
+	world.setFarStorage(&dag);
+
+	auto updateAt = [&](glm::vec3 position) {
+		for (int frame = 0; frame < 4; frame++)
+			world.update(0.016f, position, view);
+	};
+
+	updateAt(glm::vec3(0.0f));
+	if (world.getChunk(glm::ivec3(0, 1, 0)) == nullptr || !world.getChunk(glm::ivec3(0, 1, 0))->isLoaded)
+		return false;
+	world.setVoxel(editPosition, sand);
+
+	updateAt(glm::vec3(1000.0f, 0.0f, 0.0f));
+	bool isStored = world.getChunk(glm::ivec3(0, 1, 0)) == nullptr && world.getVoxel(editPosition).id == sand.id;
+
+	updateAt(glm::vec3(0.0f));
+	const Chunk* chunk = world.getChunk(glm::ivec3(0, 1, 0));
+	return isStored && chunk != nullptr && chunk->isLoaded && world.getVoxel(editPosition).id == sand.id;
+}
+
+int main()
+{
+	const double squareKilometers = (RegionSize * Chunk::ChunkSize / 1000.0) * (RegionSize * Chunk::ChunkSize / 1000.0);
+
+	std::vector<Chunk> chunks = generateRegion();
+
+	size_t rawBytes = 0;
+	size_t paletteBytes = 0;
+	for (Chunk& chunk : chunks)
+	{
+		chunk.voxels.compact();
+		rawBytes += chunk.voxels.getVoxelCount() * sizeof(Voxel);
+		paletteBytes += chunk.voxels.getMemoryUsage();
+	}
+
+	VoxelDag dag;
+	BenchTimer storeTimer;
+	for (const Chunk& chunk : chunks)
+		dag.storeChunk(chunk);
+	double storeUs = storeTimer.elapsedMs() * 1000.0 / chunks.size();
+
+	std::cout << "terrain, " << chunks.size() << " chunks of " << Chunk::ChunkSize << "^3 (" << std::fixed << std::setprecision(2)
+		<< squareKilometers << " km2, " << RegionHeight * Chunk::ChunkSize << " m deep), " << dag.getNodeCount() << " dag nodes" << std::endl;
+
+	auto printMemory = [&](const char* name, size_t bytes) {
+		std::cout << "  " << std::left << std::setw(12) << name << std::right << std::setprecision(1)
+			<< std::setw(10) << bytes / (1024.0 * 1024.0) / squareKilometers << " MB/km2"
+			<< "  x" << std::setprecision(1) << (double)rawBytes / bytes << std::endl;
+	};
+
+	printMemory("raw", rawBytes);
+	printMemory("paletted", paletteBytes);
+	printMemory("dag nodes", dag.getNodeMemoryUsage());
+	printMemory("dag", dag.getMemoryUsage());
+
+	// load back, through the paletted storage like the load stage does
+	Chunk chunk;
+	BenchTimer loadTimer;
+	for (const Chunk& source : chunks)
+		dag.loadChunk(source.coord, chunk);
+	double loadUs = loadTimer.elapsedMs() * 1000.0 / chunks.size();
+
+	std::mt19937 rng(1337);
+	std::uniform_int_distribution<int> horizontal(0, RegionSize * Chunk::ChunkSize - 1);
+	std::uniform_int_distribution<int> vertical(-Chunk::ChunkSize, (RegionHeight - 1) * Chunk::ChunkSize - 1);
+	std::vector<glm::ivec3> positions(QueryCount / 8);
+	for (glm::ivec3& position : positions)
+		position = glm::ivec3(horizontal(rng), vertical(rng), horizontal(rng));
+
+	uint64_t checksum = 0;
+	BenchTimer queryTimer;
+	for (int run = 0; run < 8; run++)
+		for (const glm::ivec3& position : positions)
+			checksum += dag.getVoxel(position).id;
+	double queryNs = queryTimer.elapsedMs() * 1e6 / QueryCount;
+
+	// a 64 m cube around the surface, and the whole region
+	uint64_t boxCount = 0;
+	uint64_t solidVolume = 0;
+	auto countBoxes = [&](glm::ivec3, int size, Voxel voxel) {
+		boxCount++;
+		if (voxel.isSolid())
+			solidVolume += static_cast<uint64_t>(size) * size * size;
+	};
+
+	BenchTimer boxTimer;
+	for (int run = 0; run < BoxRuns; run++)
+		dag.forEachBox(glm::ivec3(100, 0, 100), glm::ivec3(164, 64, 164), countBoxes);
+	double boxUs = boxTimer.elapsedMs() * 1000.0 / BoxRuns;
+	uint64_t regionBoxCount = boxCount / BoxRuns;
+
+	boxCount = 0;
+	solidVolume = 0;
+	BenchTimer worldBoxTimer;
+	dag.forEachBox(glm::ivec3(INT32_MIN / 2), glm::ivec3(INT32_MAX / 2), countBoxes);
+	double worldBoxMs = worldBoxTimer.elapsedMs();
+	readSink = checksum + solidVolume;
+
+	std::cout << std::setprecision(1)
+		<< "  store " << storeUs << " us/chunk, load " << loadUs << " us/chunk"
+		<< std::setprecision(2) << ", " << queryNs << " ns/get" << std::endl
+		<< std::setprecision(1)
+		<< "  boxes of a 64^3 region " << regionBoxCount << " in " << boxUs << " us"
+		<< ", of the whole region " << boxCount << " in " << worldBoxMs << " ms" << std::endl;
+
+	bool isCorrect = true;
+
+	uint64_t expectedSolidVolume = 0;
+	for (const Chunk& source : chunks)
+	{
+		for (uint32_t index = 0; index < source.voxels.getVoxelCount(); index++)
+			expectedSolidVolume += source.voxels.get(index).isSolid() ? 1 : 0;
+	}
+
+	if (solidVolume != expectedSolidVolume)
+	{
+		std::cout << "  boxes DO NOT cover the solid voxels" << std::endl;
+		isCorrect = false;
+	}
+
+	if (!checkRoundTrip(dag, chunks))
+	{
+		std::cout << "  stored chunks DO NOT give back their voxels" << std::endl;
+		isCorrect = false;
+	}
+
+	// overwrite half the chunks with air then collect, the other half must be untouched
+	size_t nodeCount = dag.getNodeCount();
+	for (size_t i = 0; i < chunks.size(); i += 2)
+	{
+		chunks[i].voxels.fill(Voxel((uint16_t)Voxel::Type::air));
+		dag.storeChunk(chunks[i]);
+	}
+	dag.collectGarbage();
+	std::cout << "  half cleared, garbage collected " << nodeCount << " -> " << dag.getNodeCount() << " nodes" << std::endl;
+
+	if (!checkRoundTrip(dag, chunks))
+	{
+		std::cout << "  chunks after garbage collection DO NOT give back their voxels" << std::endl;
+		isCorrect = false;
+	}
+
+	if (!checkWorldFarStorage())
+	{
+		std::cout << "  world edits ARE LOST through the far storage" << std::endl;
+		isCorrect = false;
+	}
+
+	return isCorrect ? EXIT_SUCCESS : EXIT_FAILURE;
+}
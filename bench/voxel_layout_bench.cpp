@@ -0,0 +1,353 @@
+// voxel order inside a chunk : linear (x, y, z) against morton, on the access patterns of the meshers
+// time and cache misses of each pattern for both layouts, then the real meshers with the layout the build uses
+// (configure with CHUNK_LAYOUT_MORTON to run them on the other one)
+
+// vulkan base
+#include "model/voxel_layout.hpp"
+#include "bench_utils.hpp"
+
+// std
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+static const int LayoutChunkCount = 64; // 4 MB of voxels, more than the L2 cache
+static const int Runs = 4;
+
+// keeps the results from being optimized away
+static volatile uint64_t readSink = 0;
+
+// hardware cache miss counters of this thread, reported as unavailable when the system does not allow them
+class CacheMissCounter
+{
+public:
+	CacheMissCounter()
+	{
+#ifdef __linux__
+		l1Misses = open(PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16));
+		llcMisses = open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+#endif
+	}
+
+	~CacheMissCounter()
+	{
+#ifdef __linux__
+		if (l1Misses >= 0)
+			close(l1Misses);
+		if (llcMisses >= 0)
+			close(llcMisses);
+#endif
+	}
+
+	// delete copy constructors
+	CacheMissCounter(const CacheMissCounter&) = delete;
+	CacheMissCounter& operator=(const CacheMissCounter&) = delete;
+
+	bool isAvailable() const { return l1Misses >= 0 && llcMisses >= 0; }
+
+	void start()
+	{
+#ifdef __linux__
+		for (int counter : { l1Misses, llcMisses })
+		{
+			if (counter < 0)
+				continue;
+			ioctl(counter, PERF_EVENT_IOC_RESET, 0);
+			ioctl(counter, PERF_EVENT_IOC_ENABLE, 0);
+		}
+#endif
+	}
+
+	// misses since start, l1 data reads then last level
+	void stop(uint64_t& l1, uint64_t& llc)
+	{
+		l1 = read(l1Misses);
+		llc = read(llcMisses);
+	}
+
+private:
+	int l1Misses = -1;
+	int llcMisses = -1;
+
+#ifdef __linux__
+	static int open(uint32_t type, uint64_t config)
+	{
+		perf_event_attr attributes;
+		std::memset(&attributes, 0, sizeof(attributes));
+		attributes.size = sizeof(attributes);
+		attributes.type = type;
+		attributes.config = config;
+		attributes.disabled = 1;
+		attributes.exclude_kernel = 1;
+		attributes.exclude_hv = 1;
+		return static_cast<int>(syscall(__NR_perf_event_open, &attributes, 0, -1, -1, 0));
+	}
+#endif
+
+	static uint64_t read(int counter)
+	{
+		uint64_t value = 0;
+#ifdef __linux__
+		if (counter < 0 || ::read(counter, &value, sizeof(value)) != sizeof(value))
+			return 0;
+		ioctl(counter, PERF_EVENT_IOC_DISABLE, 0);
+#endif
+		return value;
+	}
+};
+
+// the bench chunks, every voxel looked up by its position so any layout can be filled from it
+static std::vector<Voxel> generateVoxels(BenchFill fill)
+{
+	const int size = Chunk::ChunkSize;
+
+	std::vector<Voxel> voxels(LayoutChunkCount * size * size * size);
+	std::mt19937 rng(1337);
+	for (int chunk = 0; chunk < LayoutChunkCount; chunk++)
+	{
+		glm::ivec3 chunkCoord(chunk % 4, (chunk / 4) % 4 - 1, chunk / 16);
+		for (int z = 0; z < size; z++)
+			for (int y = 0; y < size; y++)
+				for (int x = 0; x < size; x++)
+					voxels[chunk * size * size * size + x + size * (y + size * z)] = getFillVoxel(fill, chunkCoord * size + glm::ivec3(x, y, z), rng);
+	}
+	return voxels;
+}
+
+template<typename Indexer>
+static std::vector<Voxel> reorder(const std::vector<Voxel>& linearVoxels)
+{
+	const int size = Chunk::ChunkSize;
+	const int chunkVoxelCount = size * size * size;
+
+	std::vector<Voxel> voxels(linearVoxels.size());
+	for (int chunk = 0; chunk < LayoutChunkCount; chunk++)
+		for (int z = 0; z < size; z++)
+			for (int y = 0; y < size; y++)
+				for (int x = 0; x < size; x++)
+					voxels[chunk * chunkVoxelCount + Indexer::getIndex(x, y, z)] = linearVoxels[chunk * chunkVoxelCount + x + size * (y + size * z)];
+	return voxels;
+}
+
+// culled mesher : every solid voxel in memory order looks at its 6 neighbours
+template<typename Indexer>
+static uint64_t countCulledFaces(const Voxel* voxels)
+{
+	const int size = Chunk::ChunkSize;
+	const glm::ivec3 offsets[6] = { { 1, 0, 0 }, { -1, 0, 0 }, { 0, 1, 0 }, { 0, -1, 0 }, { 0, 0, 1 }, { 0, 0, -1 } };
+
+	uint64_t faceCount = 0;
+	for (int index = 0; index < size * size * size; index++)
+	{
+		if (!voxels[index].isSolid())
+			continue;
+
+		glm::ivec3 position = Indexer::getPosition(index);
+		for (const glm::ivec3& offset : offsets)
+		{
+			glm::ivec3 neighbour = position + offset;
+			if (!Chunk::isInside(neighbour.x, neighbour.y, neighbour.z) || !voxels[Indexer::getIndex(neighbour.x, neighbour.y, neighbour.z)].isSolid())
+				faceCount++;
+		}
+	}
+	return faceCount;
+}
+
+// greedy mesher : slices swept along each axis, the voxel and the one in front of it
+template<typename Indexer>
+static uint64_t countSliceFaces(const Voxel* voxels)
+{
+	const int size = Chunk::ChunkSize;
+
+	uint64_t faceCount = 0;
+	for (int axis = 0; axis < 3; axis++)
+	{
+		int u = (axis + 1) % 3;
+		int v = (axis + 2) % 3;
+
+		for (int depth = 0; depth < size; depth++)
+		{
+			glm::ivec3 position;
+			position[axis] = depth;
+			for (int j = 0; j < size; j++)
+			{
+				for (int i = 0; i < size; i++)
+				{
+					position[u] = i;
+					position[v] = j;
+
+					glm::ivec3 neighbour = position;
+					neighbour[axis]++;
+					bool isNeighbourSolid = neighbour[axis] < size && voxels[Indexer::getIndex(neighbour.x, neighbour.y, neighbour.z)].isSolid();
+					if (voxels[Indexer::getIndex(position.x, position.y, position.z)].isSolid() && !isNeighbourSolid)
+						faceCount++;
+				}
+			}
+		}
+	}
+	return faceCount;
+}
+
+// binary mesher : the occupancy columns of the three axes filled in one pass
+template<typename Indexer>
+static uint64_t fillColumns(const Voxel* voxels)
+{
+	const int size = Chunk::ChunkSize;
+
+	thread_local std::vector<uint64_t> columns[3];
+	for (int axis = 0; axis < 3; axis++)
+		columns[axis].assign(size * size, 0);
+
+	for (int z = 0; z < size; z++)
+	{
+		for (int y = 0; y < size; y++)
+		{
+			for (int x = 0; x < size; x++)
+			{
+				uint64_t solid = voxels[Indexer::getIndex(x, y, z)].isSolid() ? 1 : 0;
+				columns[0][y + z * size] |= solid << x;
+				columns[1][z + x * size] |= solid << y;
+				columns[2][x + y * size] |= solid << z;
+			}
+		}
+	}
+
+	uint64_t checksum = 0;
+	for (int axis = 0; axis < 3; axis++)
+		for (uint64_t column : columns[axis])
+			checksum += column * (axis + 1);
+	return checksum;
+}
+
+struct PatternResult
+{
+	double us = 0.0;
+	uint64_t l1Misses = 0;
+	uint64_t llcMisses = 0;
+	uint64_t result = 0;
+};
+
+template<typename Indexer>
+static PatternResult runPattern(uint64_t (*pattern)(const Voxel*), const std::vector<Voxel>& voxels, CacheMissCounter& counter)
+{
+	const int chunkVoxelCount = Chunk::ChunkSize * Chunk::ChunkSize * Chunk::ChunkSize;
+
+	PatternResult result{};
+	counter.start();
+	BenchTimer timer;
+	for (int run = 0; run < Runs; run++)
+	{
+		for (int chunk = 0; chunk < LayoutChunkCount; chunk++)
+		{
+			uint64_t chunkResult = pattern(voxels.data() + chunk * chunkVoxelCount);
+			if (run == 0)
+				result.result += chunkResult;
+		}
+	}
+	result.us = timer.elapsedMs() * 1000.0 / (Runs * LayoutChunkCount);
+	counter.stop(result.l1Misses, result.llcMisses);
+	result.l1Misses /= Runs * LayoutChunkCount;
+	result.llcMisses /= Runs * LayoutChunkCount;
+	return result;
+}
+
+using LinearIndexer = VoxelIndexer<VoxelLayout::linear, Chunk::ChunkSize>;
+using MortonIndexer = VoxelIndexer<VoxelLayout::morton, Chunk::ChunkSize>;
+
+// both layouts on one pattern, the two must find the same faces
+static bool comparePattern(const char* name, uint64_t (*linearPattern)(const Voxel*), uint64_t (*mortonPattern)(const Voxel*),
+	const std::vector<Voxel>& linearVoxels, const std::vector<Voxel>& mortonVoxels, CacheMissCounter& counter)
+{
+	PatternResult linear = runPattern<LinearIndexer>(linearPattern, linearVoxels, counter);
+	PatternResult morton = runPattern<MortonIndexer>(mortonPattern, mortonVoxels, counter);
+
+	auto print = [&](const char* layout, const PatternResult& result) {
+		std::cout << "  " << std::left << std::setw(9) << name << std::setw(8) << layout << std::right << std::fixed << std::setprecision(1)
+			<< std::setw(8) << result.us << " us/chunk";
+		if (counter.isAvailable())
+			std::cout << std::setw(9) << result.l1Misses << " L1 misses" << std::setw(7) << result.llcMisses << " LLC misses";
+		std::cout << std::endl;
+	};
+
+	print("linear", linear);
+	print("morton", morton);
+
+	if (linear.result != morton.result)
+	{
+		std::cout << "  " << name << " results DO NOT match between the layouts" << std::endl;
+		return false;
+	}
+	return true;
+}
+
+int main()
+{
+	bool isCorrect = true;
+	CacheMissCounter counter;
+
+	// the index functions must be inverse of each other
+	for (int index = 0; index < Chunk::ChunkSize * Chunk::ChunkSize * Chunk::ChunkSize; index++)
+	{
+		glm::ivec3 linear = LinearIndexer::getPosition(index);
+		glm::ivec3 morton = MortonIndexer::getPosition(index);
+		if (LinearIndexer::getIndex(linear.x, linear.y, linear.z) != index || MortonIndexer::getIndex(morton.x, morton.y, morton.z) != index)
+		{
+			std::cout << "voxel indices DO NOT round trip at " << index << std::endl;
+			return EXIT_FAILURE;
+		}
+	}
+
+	std::cout << "chunk size " << Chunk::ChunkSize << ", " << LayoutChunkCount << " chunks, "
+		<< (counter.isAvailable() ? "cache misses per chunk" : "cache miss counters unavailable") << std::endl;
+
+	for (BenchFill fill : { BenchFill::random, BenchFill::terrain })
+	{
+		std::vector<Voxel> linearVoxels = reorder<LinearIndexer>(generateVoxels(fill));
+		std::vector<Voxel> mortonVoxels = reorder<MortonIndexer>(linearVoxels);
+
+		std::cout << getFillName(fill) << std::endl;
+		isCorrect = comparePattern("culled", countCulledFaces<LinearIndexer>, countCulledFaces<MortonIndexer>, linearVoxels, mortonVoxels, counter) && isCorrect;
+		isCorrect = comparePattern("slices", countSliceFaces<LinearIndexer>, countSliceFaces<MortonIndexer>, linearVoxels, mortonVoxels, counter) && isCorrect;
+		isCorrect = comparePattern("columns", fillColumns<LinearIndexer>, fillColumns<MortonIndexer>, linearVoxels, mortonVoxels, counter) && isCorrect;
+	}
+
+	// the full pipeline, snapshot included, with the layout of this build
+	std::cout << "meshers, " << (Chunk::Layout == VoxelLayout::morton ? "morton" : "linear") << " layout" << std::endl;
+	for (BenchFill fill : { BenchFill::random, BenchFill::terrain })
+	{
+		World world;
+		fillWorld(world, fill);
+
+		for (ChunkMesher::Type type : { ChunkMesher::Type::culled, ChunkMesher::Type::greedy, ChunkMesher::Type::binary })
+		{
+			ChunkMeshData mesh;
+			size_t quadCount = 0;
+			BenchTimer timer;
+			for (int run = 0; run < Runs; run++)
+			{
+				for (int chunkIndex = 0; chunkIndex < BenchChunkCount; chunkIndex++)
+				{
+					mesh.clear();
+					ChunkMesher::generate(type, world, getBenchChunkCoord(chunkIndex), mesh);
+					quadCount += run == 0 ? mesh.getQuadCount() : 0;
+				}
+			}
+			double us = timer.elapsedMs() * 1000.0 / (Runs * BenchChunkCount);
+			readSink = quadCount;
+
+			std::cout << "  " << std::left << std::setw(9) << getFillName(fill) << std::setw(8) << ChunkMesher::getTypeName(type)
+				<< std::right << std::fixed << std::setprecision(1) << std::setw(8) << us << " us/chunk"
+				<< std::setw(8) << quadCount / BenchChunkCount << " quads" << std::endl;
+		}
+	}
+
+	return isCorrect ? EXIT_SUCCESS : EXIT_FAILURE;
+}
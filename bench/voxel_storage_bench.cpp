@@ -0,0 +1,187 @@
+// palette compressed voxel storage : resident memory, access and decode cost against a plain voxel array
+
+// vulkan base
+#include "bench_utils.hpp"
+
+// std
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+static const int ColumnSize = 4;   // chunks along x and z
+static const int ColumnHeight = 4; // chunks along y, from below the terrain to the sky above it
+static const int AccessCount = 4000000;
+static const int DecodeRuns = 10;
+
+// keeps the reads from being optimized away
+static volatile uint64_t readSink = 0;
+
+struct StorageResult
+{
+	size_t rawBytes = 0;
+	size_t paletteBytes = 0;
+	uint32_t maxBits = 0;
+	uint32_t uniformCount = 0;
+	double getNs = 0.0;
+	double setNs = 0.0;
+	double decodeUs = 0.0;
+	double copyUs = 0.0;
+	bool isExact = true;
+};
+
+static StorageResult benchFill(BenchFill fill)
+{
+	const uint32_t voxelCount = Chunk::ChunkSize * Chunk::ChunkSize * Chunk::ChunkSize;
+
+	StorageResult result{};
+	std::mt19937 rng(1337);
+
+	std::vector<Chunk> chunks(ColumnSize * ColumnSize * ColumnHeight);
+	for (size_t i = 0; i < chunks.size(); i++)
+	{
+		glm::ivec3 chunkCoord(i % ColumnSize, (int)(i / ColumnSize) % ColumnHeight - 1, i / (ColumnSize * ColumnHeight));
+		chunks[i].coord = chunkCoord;
+		fillChunk(chunks[i], chunkCoord, fill, rng);
+		chunks[i].voxels.compact();
+
+		result.rawBytes += voxelCount * sizeof(Voxel);
+		result.paletteBytes += chunks[i].voxels.getMemoryUsage();
+		result.maxBits = std::max(result.maxBits, chunks[i].voxels.getBitsPerVoxel());
+		result.uniformCount += chunks[i].voxels.isUniform() ? 1 : 0;
+	}
+
+	// random reads and writes in one chunk with the surface in it
+	Chunk& chunk = chunks[ColumnSize];
+	std::vector<uint32_t> indices(AccessCount / 16);
+	for (uint32_t& index : indices)
+		index = rng() % voxelCount;
+
+	uint64_t checksum = 0;
+	BenchTimer getTimer;
+	for (int run = 0; run < 16; run++)
+		for (uint32_t index : indices)
+			checksum += chunk.voxels.get(index).id;
+	result.getNs = getTimer.elapsedMs() * 1e6 / AccessCount;
+	readSink = checksum;
+
+	std::vector<Voxel> reference(voxelCount);
+	chunk.voxels.decode(reference.data());
+
+	BenchTimer setTimer;
+	for (int run = 0; run < 16; run++)
+		for (uint32_t index : indices)
+			chunk.voxels.set(index, reference[index]);
+	result.setNs = setTimer.elapsedMs() * 1e6 / AccessCount;
+
+	// what every snapshot does for the mesher, against copying an uncompressed chunk
+	std::vector<Voxel> decoded(voxelCount);
+	BenchTimer decodeTimer;
+	for (int run = 0; run < DecodeRuns; run++)
+		for (const Chunk& source : chunks)
+			source.voxels.decode(decoded.data());
+	result.decodeUs = decodeTimer.elapsedMs() * 1000.0 / (DecodeRuns * chunks.size());
+
+	BenchTimer copyTimer;
+	for (int run = 0; run < DecodeRuns; run++)
+		for (size_t i = 0; i < chunks.size(); i++)
+			std::memcpy(decoded.data(), reference.data(), voxelCount * sizeof(Voxel));
+	result.copyUs = copyTimer.elapsedMs() * 1000.0 / (DecodeRuns * chunks.size());
+	readSink = decoded[voxelCount / 2].id;
+
+	// the storage must give back exactly what was written, through get and through decode
+	for (Chunk& source : chunks)
+	{
+		source.voxels.decode(decoded.data());
+		for (uint32_t index = 0; index < voxelCount; index++)
+		{
+			if (decoded[index].id != source.voxels.get(index).id)
+				result.isExact = false;
+		}
+	}
+
+	chunk.voxels.decode(decoded.data());
+	result.isExact = result.isExact && std::memcmp(decoded.data(), reference.data(), voxelCount * sizeof(Voxel)) == 0;
+
+	return result;
+}
+
+// snapshot and mesh the center of a 3x3x3 block of chunks : uniform air, uniform stone buried in stone,
+// and a uniform stone chunk with one open side which has to be meshed normally
+static bool benchUniformMeshing()
+{
+	const Voxel air((uint16_t)Voxel::Type::air);
+	const Voxel stone((uint16_t)Voxel::Type::stone);
+	const int Runs = 200;
+
+	World world;
+	for (int z = -1; z <= 1; z++)
+		for (int y = -1; y <= 1; y++)
+			for (int x = -1; x <= 1; x++)
+				world.chunks[world.createChunk(glm::ivec3(x, y, z))].load();
+
+	std::cout << "uniform chunks, snapshot and binary mesher" << std::endl;
+
+	bool isCorrect = true;
+	auto bench = [&](const char* name, Voxel center, Voxel around, Voxel top, bool expectQuads) {
+		for (Chunk& chunk : world.chunks)
+			chunk.voxels.fill(chunk.coord == glm::ivec3(0) ? center : chunk.coord == glm::ivec3(0, -1, 0) ? top : around);
+
+		ChunkMeshData mesh;
+		BenchTimer timer;
+		for (int run = 0; run < Runs; run++)
+		{
+			mesh.clear();
+			ChunkMesher::generate(ChunkMesher::Type::binary, world, glm::ivec3(0), mesh);
+		}
+		double us = timer.elapsedMs() * 1000.0 / Runs;
+
+		std::cout << "  " << std::left << std::setw(10) << name << std::right << std::fixed << std::setprecision(1)
+			<< std::setw(8) << us << " us/chunk" << std::setw(6) << mesh.getQuadCount() << " quads" << std::endl;
+
+		if ((mesh.getQuadCount() > 0) != expectQuads)
+		{
+			std::cout << "  " << name << " chunk meshed WRONG" << std::endl;
+			isCorrect = false;
+		}
+	};
+
+	bench("air", air, stone, stone, false);
+	bench("buried", stone, stone, stone, false);
+	bench("open top", stone, stone, air, true);
+
+	return isCorrect;
+}
+
+int main()
+{
+	bool isExact = true;
+
+	std::cout << "chunk size " << Chunk::ChunkSize << ", " << ColumnSize * ColumnSize * ColumnHeight << " chunks per fill" << std::endl;
+
+	for (BenchFill fill : { BenchFill::random, BenchFill::solid, BenchFill::terrain })
+	{
+		StorageResult result = benchFill(fill);
+		std::cout << "  " << std::left << std::setw(8) << getFillName(fill) << std::right << std::fixed << std::setprecision(1)
+			<< std::setw(8) << result.rawBytes / 1024.0 << " KB raw"
+			<< std::setw(8) << result.paletteBytes / 1024.0 << " KB paletted"
+			<< "  x" << (double)result.rawBytes / result.paletteBytes
+			<< std::setw(4) << result.maxBits << " bits max"
+			<< std::setw(4) << result.uniformCount << " uniform"
+			<< std::setprecision(2) << std::setw(7) << result.getNs << " ns/get"
+			<< std::setw(7) << result.setNs << " ns/set"
+			<< std::setprecision(1) << std::setw(7) << result.decodeUs << " us/decode"
+			<< " (copy " << result.copyUs << " us)" << std::endl;
+
+		if (!result.isExact)
+		{
+			std::cout << "  " << getFillName(fill) << " storage DOES NOT give back the written voxels" << std::endl;
+			isExact = false;
+		}
+	}
+
+	if (!benchUniformMeshing())
+		isExact = false;
+
+	return isExact ? EXIT_SUCCESS : EXIT_FAILURE;
+}
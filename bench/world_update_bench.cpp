@@ -0,0 +1,147 @@
+// heap allocations made by World::update while chunks stream around the camera, with and without the task scheduler
+// every operator new of the process is counted, the updates are measured once the lists have reached their capacity
+
+// vulkan base
+#include "bench_utils.hpp"
+#include "job/task_scheduler.hpp"
+
+// std
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+static std::atomic<uint64_t> allocationCount{ 0 };
+static std::atomic<uint64_t> allocatedBytes{ 0 };
+
+void* operator new(std::size_t size)
+{
+	allocationCount++;
+	allocatedBytes += size;
+
+	if (void* memory = std::malloc(size == 0 ? 1 : size))
+		return memory;
+	throw std::bad_alloc();
+}
+
+void operator delete(void* memory) noexcept
+{
+	std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept
+{
+	std::free(memory);
+}
+
+static const int UpdateCount = 1000;
+
+enum class CameraPath
+{
+	still,     // nothing to do, the visibility pass is skipped
+	turning,   // visibility pass and render list sort every update, no chunk changes state
+	flying     // chunks are created, loaded, setup and destroyed as the camera moves
+};
+
+static const char* getPathName(CameraPath path)
+{
+	switch (path)
+	{
+	case CameraPath::still: return "still";
+	case CameraPath::turning: return "turning";
+	case CameraPath::flying: return "flying";
+	}
+	return "unknown";
+}
+
+static void getCamera(CameraPath path, int frame, glm::vec3& position, glm::vec3& view)
+{
+	position = glm::vec3(0.0f, Chunk::ChunkSize, 0.0f);
+	view = glm::vec3(0.0f);
+
+	if (path == CameraPath::turning)
+		view.y = frame * 0.01f;
+
+	// back and forth along x over 8 chunks, a lap is 200 updates
+	if (path == CameraPath::flying)
+	{
+		float lap = (frame % 200) / 100.0f;
+		float offset = lap < 1.0f ? lap : 2.0f - lap;
+		position.x += (offset - 0.5f) * 8.0f * Chunk::ChunkSize;
+		view.y = lap < 1.0f ? glm::radians(90.0f) : glm::radians(-90.0f);
+	}
+}
+
+struct UpdateCost
+{
+	double allocationsPerUpdate;
+	double bytesPerUpdate;
+	double usPerUpdate;
+};
+
+static UpdateCost benchUpdates(World& world, CameraPath path)
+{
+	glm::vec3 position, view;
+
+	// one full lap first : loads the area around the camera and grows the lists to their working size
+	for (int frame = 0; frame < 200; frame++)
+	{
+		getCamera(path, frame, position, view);
+		world.update(0.016f, position, view);
+	}
+
+	uint64_t firstCount = allocationCount.load();
+	uint64_t firstBytes = allocatedBytes.load();
+
+	BenchTimer timer;
+	for (int frame = 200; frame < 200 + UpdateCount; frame++)
+	{
+		getCamera(path, frame, position, view);
+		world.update(0.016f, position, view);
+	}
+	double ms = timer.elapsedMs();
+
+	return { (double)(allocationCount.load() - firstCount) / UpdateCount, (double)(allocatedBytes.load() - firstBytes) / UpdateCount, ms * 1000.0 / UpdateCount };
+}
+
+int main()
+{
+	TaskScheduler taskScheduler;
+
+	std::cout << "visibility radius " << World::VisibilityRadius << ", averaged over " << UpdateCount << " updates" << std::endl;
+
+	bool isAllocationFree = true;
+	for (bool useScheduler : { false, true })
+	{
+		std::cout << (useScheduler ? "task scheduler, " : "serial, ") << (useScheduler ? taskScheduler.getThreadCount() : 0) << " worker threads" << std::endl;
+
+		World world;
+		world.setChunkGenerator([](Chunk& chunk) {
+			std::mt19937 rng;
+			fillChunk(chunk, chunk.coord, BenchFill::terrain, rng);
+		});
+		world.setTaskScheduler(useScheduler ? &taskScheduler : nullptr);
+
+		for (CameraPath path : { CameraPath::still, CameraPath::turning, CameraPath::flying })
+		{
+			UpdateCost cost = benchUpdates(world, path);
+			std::cout << "  " << std::left << std::setw(8) << getPathName(path) << std::right << std::fixed
+				<< std::setprecision(2) << std::setw(8) << cost.allocationsPerUpdate << " allocs/update"
+				<< std::setprecision(0) << std::setw(8) << cost.bytesPerUpdate << " bytes/update"
+				<< std::setprecision(1) << std::setw(8) << cost.usPerUpdate << " us/update"
+				<< std::setw(6) << world.getChunkCount() << " chunks, " << world.chunks.size() << " slots" << std::endl;
+
+			// without streaming only the tasks of the scheduler may allocate
+			// streamed chunks take their voxel indices from the block pool, only their palettes allocate
+			if (!useScheduler && path != CameraPath::flying && cost.allocationsPerUpdate > 0.0)
+				isAllocationFree = false;
+		}
+	}
+
+	if (!isAllocationFree)
+	{
+		std::cout << "  serial updates allocated" << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
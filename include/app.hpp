@@ -36,6 +36,9 @@ public:
 	bool key = false;
 	bool prevKey = false;
 
+	bool mesherKey = false;
+	bool prevMesherKey = false;
+
 	App();
 	~App();
 
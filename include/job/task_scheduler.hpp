@@ -0,0 +1,89 @@
+#pragma once
+
+// std
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// work stealing task scheduler : every worker owns a deque, pushes and pops its own tasks at the back
+// and steals from the front of the others when it runs dry
+// tasks submitted from outside of the workers go to one extra shared deque, background tasks to another one
+// that only the workers and waitAll take from
+// a task only becomes ready once all of its dependencies have finished, tasks must not throw
+class TaskScheduler
+{
+public:
+	struct Task
+	{
+		std::function<void()> work;
+
+		// unfinished dependencies, plus one while the task is being submitted
+		std::atomic<uint32_t> pendingCount{ 1 };
+		std::atomic<bool> isFinished{ false };
+		bool isBackground = false;
+
+		// guards dependents against the task finishing while a new dependent registers
+		std::mutex mutex;
+		std::vector<std::shared_ptr<Task>> dependents;
+	};
+
+	using TaskHandle = std::shared_ptr<Task>;
+
+	// 0 uses every core but the one running the render thread
+	explicit TaskScheduler(uint32_t threadCount = 0);
+	// runs the remaining tasks before stopping the workers
+	~TaskScheduler();
+
+	// delete copy constructors
+	TaskScheduler(const TaskScheduler&) = delete;
+	TaskScheduler& operator=(const TaskScheduler&) = delete;
+
+	// work runs once every dependency has finished, null dependencies are ignored
+	TaskHandle submit(std::function<void()> work, const std::vector<TaskHandle>& dependencies = {});
+	// long work nothing waits on right away (meshing), never picked up by a thread blocked in wait
+	// so that waiting on a short task does not cost one of these
+	TaskHandle submitBackground(std::function<void()> work);
+
+	// the calling thread runs tasks until task has finished, background tasks excepted
+	void wait(const TaskHandle& task);
+	// the calling thread runs tasks, background ones too, until every submitted task has finished
+	void waitAll();
+
+	uint32_t getThreadCount() const { return static_cast<uint32_t>(threads.size()); }
+
+private:
+	struct TaskQueue
+	{
+		std::mutex mutex;
+		std::deque<TaskHandle> tasks;
+	};
+
+	void workerLoop(uint32_t queueIndex);
+
+	// queue of the calling thread : its own deque for a worker, the shared one otherwise
+	uint32_t getQueueIndex() const;
+	uint32_t getBackgroundQueueIndex() const { return static_cast<uint32_t>(queues.size() - 1); }
+
+	void schedule(TaskHandle task);
+	bool runOneTask(uint32_t queueIndex, bool runsBackground);
+	void finish(const TaskHandle& task);
+
+	std::vector<std::unique_ptr<TaskQueue>> queues;
+	std::vector<std::thread> threads;
+
+	std::atomic<uint32_t> queuedCount{ 0 };
+	std::atomic<uint32_t> unfinishedCount{ 0 };
+
+	std::mutex sleepMutex;
+	std::condition_variable wakeUp;
+	std::atomic<uint32_t> sleepingCount{ 0 };
+	bool isStopping = false;
+
+	static thread_local const TaskScheduler* currentScheduler;
+	static thread_local uint32_t currentQueueIndex;
+};
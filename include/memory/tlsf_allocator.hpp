@@ -0,0 +1,88 @@
+#pragma once
+
+// std
+#include <array>
+#include <cstdint>
+#include <vector>
+
+// two level segregated fit allocator of the ranges of one memory block, it only deals with offsets
+// and never touches the memory itself, so it works the same on gpu memory and is usable without a device
+// the free ranges are sorted in lists by size : 16 lists per power of two, found with two bit scans,
+// allocate and free are O(1) and a freed range is merged at once with the free ranges around it
+class TlsfAllocator
+{
+public:
+	static const uint32_t NullBlock = UINT32_MAX;
+	// every range is a multiple of it, and so aligned on it
+	static const uint64_t Granularity = 16;
+
+	struct Allocation
+	{
+		uint64_t offset = 0;
+		uint64_t size = 0;
+		uint32_t block = NullBlock;
+
+		bool isValid() const { return block != NullBlock; }
+	};
+
+	explicit TlsfAllocator(uint64_t size);
+
+	// false when no free range is large enough, alignment must be a power of two
+	bool allocate(uint64_t size, uint64_t alignment, Allocation& allocation);
+	void free(Allocation& allocation);
+
+	uint64_t getSize() const { return size; }
+	uint64_t getUsedSize() const { return usedSize; }
+	uint64_t getFreeSize() const { return size - usedSize; }
+	uint32_t getAllocationCount() const { return allocationCount; }
+	uint32_t getFreeRangeCount() const { return freeRangeCount; }
+	// looks at the non empty lists of the largest size class only
+	uint64_t getLargestFreeRange() const;
+	bool empty() const { return allocationCount == 0; }
+
+private:
+	static const uint32_t SecondLevelLog2 = 4;
+	static const uint32_t SecondLevelCount = 1u << SecondLevelLog2;
+	static const uint32_t FirstLevelCount = 64 - SecondLevelLog2 + 1;
+
+	// a range of the block, free or allocated, linked to the ranges before and after it in memory
+	// and, when free, to the other free ranges of its list
+	struct Block
+	{
+		uint64_t offset = 0;
+		uint64_t size = 0;
+		uint32_t previousPhysical = NullBlock;
+		uint32_t nextPhysical = NullBlock;
+		uint32_t previousFree = NullBlock;
+		uint32_t nextFree = NullBlock;
+		bool isFree = false;
+	};
+
+	uint64_t size;
+	uint64_t usedSize = 0;
+	uint32_t allocationCount = 0;
+	uint32_t freeRangeCount = 0;
+
+	std::vector<Block> blocks;
+	// slots of blocks merged away, reused before blocks grows
+	std::vector<uint32_t> unusedBlocks;
+
+	// bit per first level with a non empty list, and per list of each first level
+	uint64_t firstLevelBitmap = 0;
+	std::array<uint32_t, FirstLevelCount> secondLevelBitmaps{};
+	std::array<std::array<uint32_t, SecondLevelCount>, FirstLevelCount> freeLists;
+
+	uint32_t createBlock(uint64_t offset, uint64_t size);
+	void destroyBlock(uint32_t block);
+	void insertFree(uint32_t block);
+	void removeFree(uint32_t block);
+	// a new free block of the end of block from offset, block keeps what comes before
+	uint32_t split(uint32_t block, uint64_t offset);
+	// the free block next to block in memory is removed and block grows over it
+	void absorbNext(uint32_t block);
+
+	// first level and list of a size
+	static void getListIndex(uint64_t size, uint32_t& firstLevel, uint32_t& secondLevel);
+	static int countTrailingZeros(uint64_t bits);
+	static int floorLog2(uint64_t value);
+};
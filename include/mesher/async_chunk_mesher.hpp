@@ -0,0 +1,53 @@
+#pragma once
+
+// vulkan base
+#include "mesher/chunk_mesher.hpp"
+#include "job/task_scheduler.hpp"
+
+// std
+#include <mutex>
+#include <vector>
+
+// meshes chunks on the task scheduler : the snapshot is taken on the calling thread, the mesher runs on a worker
+// and only reads the snapshot, the snapshots come from a pool and go back to it once meshed
+// and the finished meshes wait until the main thread collects them for upload
+class AsyncChunkMesher
+{
+public:
+	struct Result
+	{
+		glm::ivec3 coord;
+		uint32_t revision;
+		ChunkMeshData meshData;
+	};
+
+	AsyncChunkMesher(TaskScheduler& taskScheduler);
+	// waits for the jobs still running
+	~AsyncChunkMesher();
+
+	// delete copy constructors
+	AsyncChunkMesher(const AsyncChunkMesher&) = delete;
+	AsyncChunkMesher& operator=(const AsyncChunkMesher&) = delete;
+
+	// sectionMask 0 meshes the whole chunk at once, otherwise only these sections with generateSections
+	void submit(ChunkMesher::Type type, const World& world, glm::ivec3 chunkCoord, VertexFormat vertexFormat, uint64_t sectionMask = 0);
+
+	// move the meshes finished since the last call at the end of results
+	void collect(std::vector<Result>& finished);
+
+	// block until every submitted chunk is meshed, the results still have to be collected
+	void wait();
+
+	uint32_t getPendingCount() const;
+	// snapshots allocated so far, the pool bounds them by the jobs in flight
+	uint32_t getSnapshotCount() const { return snapshotPool.getCreatedCount(); }
+
+private:
+	TaskScheduler& taskScheduler;
+	ChunkSnapshotPool snapshotPool;
+
+	// guards results and pendingCount, written by the workers
+	mutable std::mutex mutex;
+	std::vector<Result> results;
+	uint32_t pendingCount = 0;
+};
@@ -0,0 +1,101 @@
+#pragma once
+
+// vulkan base
+#include "vvb_mesh.hpp"
+#include "model/voxel.hpp"
+#include "mesher/chunk_snapshot.hpp"
+
+// std
+#include <array>
+#include <vector>
+
+// cpu side geometry of a chunk, ready to be uploaded to a VvbChunkBuffer
+// the meshers fill vertices or packedVertices depending on vertexFormat
+// every face is a quad of 4 consecutive vertices, indices come from the shared VvbQuadIndexBuffer
+struct ChunkMeshData
+{
+	VertexFormat vertexFormat = VertexFormat::Standard;
+
+	std::vector<Vertex> vertices;
+	std::vector<PackedVertex> packedVertices;
+
+	// filled by generateSections : the sections meshed, and their vertices one section after the other
+	uint64_t sectionMask = 0;
+	std::array<uint32_t, Chunk::SectionCount> sectionVertexCounts{};
+
+	void clear();
+	uint32_t getVertexCount() const { return static_cast<uint32_t>(vertexFormat == VertexFormat::Packed ? packedVertices.size() : vertices.size()); }
+	uint32_t getVertexSize() const { return vertexFormat == VertexFormat::Packed ? sizeof(PackedVertex) : sizeof(Vertex); }
+	const void* getVertexData() const { return vertexFormat == VertexFormat::Packed ? (const void*)packedVertices.data() : (const void*)vertices.data(); }
+	uint32_t getQuadCount() const { return getVertexCount() / 4; }
+	uint32_t getIndexCount() const { return getQuadCount() * 6; }
+	bool empty() const { return getVertexCount() == 0; }
+};
+
+class ChunkMesher
+{
+public:
+	enum class Type
+	{
+		naive = 0,
+		culled,
+		greedy,
+		binary,
+		NUM_TYPES
+	};
+
+	enum class Face
+	{
+		front = 0,	// +z
+		back,		// -z
+		left,		// -x
+		right,		// +x
+		top,		// +y
+		bottom,		// -y
+		NUM_FACES
+	};
+
+	// run the mesher selected by type, the meshers only read the snapshot so they are safe on any thread
+	// every mesher works on the cube of size voxels at origin (the whole chunk by default), in chunk coordinates
+	// and only emits the faces of the voxels inside it, the voxels around it are read to cull the faces
+	static void generate(Type type, const ChunkSnapshot& snapshot, ChunkMeshData& mesh, glm::ivec3 origin = glm::ivec3(0), int size = Chunk::ChunkSize);
+	// snapshot the chunk then mesh it on the calling thread
+	static void generate(Type type, const World& world, glm::ivec3 chunkCoord, ChunkMeshData& mesh);
+	// mesh the sections of sectionMask one after the other, sectionVertexCounts tells where each one is
+	// faces are not merged across sections, a section can then be meshed again and patched on its own
+	static void generateSections(Type type, const ChunkSnapshot& snapshot, uint64_t sectionMask, ChunkMeshData& mesh);
+	static const char* getTypeName(Type type);
+
+	// emit the 6 faces of every solid voxel, whatever their neighbours are
+	static void generateNaive(const ChunkSnapshot& snapshot, ChunkMeshData& mesh, glm::ivec3 origin = glm::ivec3(0), int size = Chunk::ChunkSize);
+
+	// emit only the faces touching air, neighbours across the chunk border are read from the snapshot padding
+	static void generateCulled(const ChunkSnapshot& snapshot, ChunkMeshData& mesh, glm::ivec3 origin = glm::ivec3(0), int size = Chunk::ChunkSize);
+
+	// merge coplanar visible faces of the same voxel type into maximal rectangles
+	static void generateGreedy(const ChunkSnapshot& snapshot, ChunkMeshData& mesh, glm::ivec3 origin = glm::ivec3(0), int size = Chunk::ChunkSize);
+
+	// greedy mesher working on 64 bit occupancy columns : faces are found with shifts and masks
+	// and merged with bit scans, the output is the same surface as generateGreedy
+	static void generateBinary(const ChunkSnapshot& snapshot, ChunkMeshData& mesh, glm::ivec3 origin = glm::ivec3(0), int size = Chunk::ChunkSize);
+
+	static glm::ivec3 getFaceNormal(Face face);
+
+	// upper bound of the quads a chunk can produce : a 3d checkerboard shows the 6 faces of half of the voxels
+	// (the naive mesher can go above it, meshes are drawn in batches anyway)
+	static uint32_t getMaxQuadCount() { return Chunk::ChunkSize * Chunk::ChunkSize * Chunk::ChunkSize * 3; }
+
+private:
+	struct FaceDescription
+	{
+		glm::ivec3 normal;
+		std::array<glm::vec3, 4> corners;
+	};
+
+	static const std::array<FaceDescription, (size_t)Face::NUM_FACES> faces;
+
+	// size stretches the unit face along its tangent axes, the normal axis must stay at 1
+	static void addFace(Face face, glm::vec3 position, uint16_t voxelId, ChunkMeshData& mesh, glm::vec3 size = glm::vec3(1.0f));
+
+	static int countTrailingZeros(uint64_t bits);
+};
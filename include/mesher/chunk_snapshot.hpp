@@ -0,0 +1,77 @@
+#pragma once
+
+// vulkan base
+#include "model/voxel.hpp"
+
+// std
+#include <cassert>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// immutable copy of everything a mesher reads : the voxels of a chunk padded with a one voxel border
+// taken from its 26 neighbours (faces, edges and corners), in one contiguous array
+// taken on the main thread, it can then be meshed on any thread while the world keeps changing
+struct ChunkSnapshot
+{
+	// voxels along each side of the padded array
+	static const int PaddedSize = Chunk::ChunkSize + 2;
+
+	glm::ivec3 coord{};
+	uint32_t revision = 0;
+
+	// PaddedSize^3 voxels x first, then y, then z, with the chunk voxel (0, 0, 0) at (1, 1, 1)
+	// the border is air where the neighbour is missing or not loaded
+	// sized once and kept by the captures, only the cells a capture reads are written
+	std::vector<Voxel> voxels;
+	// nothing to mesh : the chunk does not exist, is not loaded, is all air,
+	// or is all solid with solid voxels all around it
+	bool isEmpty = true;
+
+	ChunkSnapshot() = default;
+	ChunkSnapshot(const World& world, glm::ivec3 chunkCoord);
+
+	void capture(const World& world, glm::ivec3 chunkCoord);
+	// only what meshing the voxels in [min, max) reads : the box and one voxel around it, the other cells
+	// keep whatever an earlier capture wrote in them
+	void capture(const World& world, glm::ivec3 chunkCoord, glm::ivec3 min, glm::ivec3 max);
+	bool empty() const { return isEmpty; }
+
+	// chunk local coordinates, from -1 to ChunkSize included on every axis
+	Voxel getVoxel(int x, int y, int z) const
+	{
+		assert(x >= -1 && y >= -1 && z >= -1 && x <= Chunk::ChunkSize && y <= Chunk::ChunkSize && z <= Chunk::ChunkSize && "snapshot only holds the direct neighbours");
+		return voxels[getPaddedIndex(x, y, z)];
+	}
+
+	static int getPaddedIndex(int x, int y, int z) { return (x + 1) + PaddedSize * ((y + 1) + PaddedSize * (z + 1)); }
+
+private:
+	// copy the voxels of a chunk in [min, max) of its local coordinates to the same cells shifted by offset chunks
+	void copyRegion(const Chunk& chunk, glm::ivec3 offset, glm::ivec3 min, glm::ivec3 max);
+	void fillRegion(Voxel voxel, glm::ivec3 offset, glm::ivec3 min, glm::ivec3 max);
+};
+
+// recycles the snapshots of the async meshers so that their padded buffers are allocated once
+// acquire on the main thread, release from any thread once the mesher is done with it
+class ChunkSnapshotPool
+{
+public:
+	ChunkSnapshotPool() = default;
+
+	// delete copy constructors
+	ChunkSnapshotPool(const ChunkSnapshotPool&) = delete;
+	ChunkSnapshotPool& operator=(const ChunkSnapshotPool&) = delete;
+
+	std::unique_ptr<ChunkSnapshot> acquire();
+	void release(std::unique_ptr<ChunkSnapshot> snapshot);
+
+	// snapshots created since the pool exists, the ones in use included
+	uint32_t getCreatedCount() const { return createdCount; }
+
+private:
+	// guards freeSnapshots, the workers give their snapshot back
+	std::mutex mutex;
+	std::vector<std::unique_ptr<ChunkSnapshot>> freeSnapshots;
+	uint32_t createdCount = 0;
+};
@@ -0,0 +1,10 @@
+#pragma once
+
+// std
+#include <cstdint>
+
+// slot of a chunk in the chunk store of the world, stays valid until the chunk is destroyed
+// the slot is then recycled for the next chunk created
+using ChunkHandle = uint32_t;
+
+static const ChunkHandle InvalidChunkHandle = UINT32_MAX;
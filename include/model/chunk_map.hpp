@@ -0,0 +1,56 @@
+#pragma once
+
+// vulkan base
+#include "model/chunk_handle.hpp"
+
+// libs
+#include <glm/glm.hpp>
+
+// std
+#include <cstddef>
+#include <vector>
+
+// open addressing hash table from signed chunk coordinates to chunk handles
+// linear probing in a power of two table kept at most half full, entries are stored inline so a lookup
+// usually touches a single cache line, erasing shifts the following entries back so there are no tombstones
+class ChunkMap
+{
+public:
+	explicit ChunkMap(size_t capacity = 64);
+
+	// InvalidChunkHandle when there is no chunk at that coordinate
+	ChunkHandle find(glm::ivec3 coord) const;
+
+	// the coordinate must not be in the map yet
+	void insert(glm::ivec3 coord, ChunkHandle handle);
+	// return false if the coordinate was not in the map
+	bool erase(glm::ivec3 coord);
+	void clear();
+
+	size_t size() const { return count; }
+	size_t capacity() const { return slots.size(); }
+
+	// call work(coord, handle) for every entry, the map must not change meanwhile
+	template<typename F>
+	void forEach(F&& work) const
+	{
+		for (const Slot& slot : slots)
+		{
+			if (slot.handle != InvalidChunkHandle)
+				work(slot.coord, slot.handle);
+		}
+	}
+
+private:
+	struct Slot
+	{
+		glm::ivec3 coord;
+		ChunkHandle handle;
+	};
+
+	std::vector<Slot> slots;
+	size_t count = 0;
+
+	size_t getHomeSlot(glm::ivec3 coord) const;
+	void grow();
+};
@@ -0,0 +1,47 @@
+#pragma once
+
+// vulkan base
+#include "model/chunk_handle.hpp"
+
+// std
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+// indexed binary min heap of chunks : the lowest priority value comes out first
+// a chunk is at most once in the queue and its priority can be changed in place in O(log n)
+// the heap position of every handle is kept in a flat array, queueing never allocates once it has seen the handles
+class ChunkQueue
+{
+public:
+	// insert the chunk, or move it to its new priority if it is already queued
+	void push(ChunkHandle chunk, float priority);
+	ChunkHandle pop();
+	void remove(ChunkHandle chunk);
+	bool contains(ChunkHandle chunk) const { return chunk < positions.size() && positions[chunk] != NotQueued; }
+
+	// recompute the priority of every queued chunk then restore the heap in one pass
+	void reprioritize(const std::function<float(ChunkHandle)>& getPriority);
+
+	void clear();
+	size_t size() const { return heap.size(); }
+	bool empty() const { return heap.empty(); }
+
+private:
+	struct Entry
+	{
+		float priority;
+		ChunkHandle chunk;
+	};
+
+	static constexpr uint32_t NotQueued = UINT32_MAX;
+
+	std::vector<Entry> heap;
+	// heap index of every handle, NotQueued if it is not in the queue
+	std::vector<uint32_t> positions;
+
+	void siftUp(size_t index);
+	void siftDown(size_t index);
+	void swapEntries(size_t a, size_t b);
+};
@@ -1,9 +1,25 @@
 #pragma once
 
+#include <array>
 #include <cstdint>
+#include <functional>
 #include <vector>
 #include <glm/glm.hpp>
 
+// vulkan base
+#include "model/chunk_map.hpp"
+#include "model/chunk_queue.hpp"
+#include "model/voxel_block_pool.hpp"
+#include "model/voxel_layout.hpp"
+#include "job/task_scheduler.hpp"
+
+class VoxelDag;
+
+// voxels along each side of a chunk
+#ifndef VVB_CHUNK_SIZE
+#define VVB_CHUNK_SIZE 32
+#endif
+
 struct Voxel
 {
 	enum class Type : uint16_t
@@ -18,14 +34,97 @@ struct Voxel
 
 	uint16_t id;
 	Voxel(uint16_t id = (uint16_t)Type::dirt);
+
+	bool isSolid() const { return id != (uint16_t)Type::air; }
+};
+
+// palette compressed voxels : every voxel holds an index into a small palette of the types present
+// the indices are packed in 64 bit words, 1, 2, 4, 8 or 16 bits wide so that none straddles two words,
+// and the width doubles whenever the palette outgrows it
+// a chunk of a handful of types takes a few KB instead of 2 bytes per voxel
+// a chunk of a single type (sky, deep stone) is uniform : 0 bits, no index array at all, the first
+// different write promotes it and compact demotes it again
+class VoxelStorage
+{
+public:
+	explicit VoxelStorage(uint32_t voxelCount = 0, Voxel voxel = Voxel());
+
+	Voxel get(uint32_t index) const { return bits == 0 ? palette[0] : palette[getPaletteIndex(index)]; }
+	void set(uint32_t index, Voxel voxel);
+
+	// every voxel becomes voxel, the palette shrinks to that single type
+	void fill(Voxel voxel);
+
+	// unpack every voxel, voxels must hold getVoxelCount() of them
+	void decode(Voxel* voxels) const;
+	// replace every voxel, the palette is rebuilt at the smallest width
+	void encode(const Voxel* voxels);
+
+	// drop the palette entries no voxel uses anymore, and narrow the indices if they fit in fewer bits
+	void compact();
+
+	// looks at the palette only : a type overwritten everywhere stays in it until compact
+	bool hasSolidType() const;
+
+	// every voxel is palette[0]
+	bool isUniform() const { return bits == 0; }
+
+	uint32_t getVoxelCount() const { return voxelCount; }
+	uint32_t getBitsPerVoxel() const { return bits; }
+	const std::vector<Voxel>& getPalette() const { return palette; }
+	// heap memory held by the palette and the indices
+	size_t getMemoryUsage() const;
+
+private:
+	uint32_t voxelCount;
+	uint32_t bits = 0;
+	// log2 of the indices per word
+	uint32_t indexShift = 0;
+
+	std::vector<Voxel> palette;
+	// from the voxel block pool, chunks streamed in and out recycle the same blocks
+	VoxelBlock words;
+
+	// last palette lookup of set, consecutive writes are most often of the same type
+	uint32_t lastPaletteIndex = 0;
+
+	uint32_t getPaletteIndex(uint32_t index) const { return readPaletteIndex(words, bits, indexShift, index); }
+
+	static uint32_t readPaletteIndex(const VoxelBlock& words, uint32_t bits, uint32_t indexShift, uint32_t index)
+	{
+		if (bits == 0)
+			return 0;
+
+		uint32_t shift = (index & ((1u << indexShift) - 1)) * bits;
+		return static_cast<uint32_t>(words[index >> indexShift] >> shift) & ((1u << bits) - 1);
+	}
+
+	void setPaletteIndex(uint32_t index, uint32_t paletteIndex);
+	uint32_t findPaletteIndex(Voxel voxel);
+
+	// repack the indices with the given width, it must fit the palette
+	void setBitsPerVoxel(uint32_t newBits);
+	// every index back to 0 with the given width, 0 frees the index array
+	void resetIndices(uint32_t newBits);
+	static uint32_t getBitsForPaletteSize(size_t paletteSize);
 };
 
 struct Chunk
 {
-	std::vector<Voxel> voxels;
-	bool isLoaded;
-	bool isSetup;
-	bool shouldRender;
+	VoxelStorage voxels;
+	glm::ivec3 coord{};
+	bool isLoaded = false;
+	bool isSetup = false;
+	bool shouldRender = false;
+
+	// bumped every time the voxels change, renderers compare it to know when to re-mesh
+	uint32_t revision = 0;
+	// revision the chunk was created with, above every revision of the chunks destroyed before it
+	// so that what was meshed for an earlier chunk at the same coordinate can be told apart
+	uint32_t firstRevision = 0;
+	// bit per section whose mesh is out of date, set along with every revision bump
+	// the renderer takes them to re-mesh only these sections
+	uint64_t dirtySections = 0;
 
 	Chunk();
 
@@ -34,32 +133,166 @@ struct Chunk
 	void rebuild();
 	void unload();
 
-	static const int ChunkSize = 1;
+	// every voxel index of the chunk, the storage, the snapshots and the meshers, goes through these two
+	static int getVoxelIndex(int x, int y, int z) { return Indexer::getIndex(x, y, z); }
+	static glm::ivec3 getVoxelPosition(int index) { return Indexer::getPosition(index); }
+	static bool isInside(int x, int y, int z) { return x >= 0 && y >= 0 && z >= 0 && x < ChunkSize && y < ChunkSize && z < ChunkSize; }
+
+	Voxel getVoxel(int x, int y, int z) const { return voxels.get(getVoxelIndex(x, y, z)); }
+	void setVoxel(int x, int y, int z, Voxel voxel) { voxels.set(getVoxelIndex(x, y, z), voxel); markDirty(x, y, z); }
+
+	// the section holding the voxel must be meshed again
+	void markDirty(int x, int y, int z) { dirtySections |= 1ull << getSectionIndex(x, y, z); revision++; }
+	// the sections along one face of the chunk, when the neighbour on that side changes
+	void markBorderDirty(int axis, bool positive);
+	void markAllDirty() { dirtySections = AllSections; revision++; }
+	uint64_t takeDirtySections() { uint64_t sections = dirtySections; dirtySections = 0; return sections; }
+
+	static int getSectionIndex(int x, int y, int z) { return x / SectionSize + SectionsPerAxis * (y / SectionSize + SectionsPerAxis * (z / SectionSize)); }
+	static glm::ivec3 getSectionOrigin(int section) { return glm::ivec3(section % SectionsPerAxis, (section / SectionsPerAxis) % SectionsPerAxis, section / (SectionsPerAxis * SectionsPerAxis)) * SectionSize; }
+	// box [min, max) of the voxels of the sections in sectionMask, the whole chunk for an empty mask
+	static void getSectionBounds(uint64_t sectionMask, glm::ivec3& min, glm::ivec3& max);
+
+	// chosen at build time with CHUNK_SIZE (16, 32 or 64), every index, loop bound and bit width derives from it
+	static const int ChunkSize = VVB_CHUNK_SIZE;
+	static_assert(ChunkSize >= 2 && ChunkSize <= 64 && (ChunkSize & (ChunkSize - 1)) == 0, "chunk size must be a power of two up to 64");
+
+	// linear unless built with CHUNK_LAYOUT_MORTON
+#ifdef VVB_CHUNK_LAYOUT_MORTON
+	static const VoxelLayout Layout = VoxelLayout::morton;
+#else
+	static const VoxelLayout Layout = VoxelLayout::linear;
+#endif
+	using Indexer = VoxelIndexer<Layout, ChunkSize>;
+
+	// 16^3 blocks of the chunk meshed on their own, an edit only re-meshes the sections it touches
+	static const int SectionSize = ChunkSize < 16 ? ChunkSize : 16;
+	static const int SectionsPerAxis = ChunkSize / SectionSize;
+	static const int SectionCount = SectionsPerAxis * SectionsPerAxis * SectionsPerAxis;
+	static const uint64_t AllSections = SectionCount == 64 ? ~0ull : (1ull << SectionCount) - 1;
 };
 
 class World
 {
 public:
 
+	// the chunk store, every list of the world refers to a chunk by its handle (slot index)
+	// the world has no bounds : chunks are created around the camera and destroyed once out of range,
+	// their slot is then recycled so the store only grows with the view distance
+	// chunks may move when the store grows, keep handles rather than pointers across updates
 	std::vector<Chunk> chunks;
-	std::vector<Chunk> renderList;
-	static const int WorldSize = 2;
-	
+	// sorted by priority, the chunks in front of the camera first
+	std::vector<ChunkHandle> renderList;
+
+	// chunks closer than this to the camera exist and are loaded, the others are destroyed (in chunks)
+	static const int VisibilityRadius = 4;
+
+	// fill the voxels of a chunk when it is loaded, runs on the workers and must only touch the chunk it is given
+	using ChunkGenerator = std::function<void(Chunk&)>;
+
 	World();
 	void update(float dt, glm::vec3 cameraPos, glm::vec3 cameraView);
 
+	// InvalidChunkHandle (UINT32_MAX) when there is no chunk at that coordinate
+	ChunkHandle findChunk(glm::ivec3 chunkCoord) const { return _chunkMap.find(chunkCoord); }
+	const Chunk* getChunk(glm::ivec3 chunkCoord) const;
+	Chunk* getChunk(glm::ivec3 chunkCoord);
+
+	// return the chunk already at that coordinate, or a new one that is not loaded yet
+	ChunkHandle createChunk(glm::ivec3 chunkCoord);
+	// the chunk leaves every list and its handle may be given to the next chunk created
+	// renderList is refreshed by the next update
+	void destroyChunk(ChunkHandle chunk);
+	size_t getChunkCount() const { return _chunkMap.size(); }
+
+	// the default generator fills everything below the height 0 (y grows downwards) with dirt
+	void setChunkGenerator(ChunkGenerator generator) { _chunkGenerator = std::move(generator); }
+
+	// voxels where there is no chunk come from the far storage, or are air
+	Voxel getVoxel(glm::ivec3 worldPosition) const;
+
+	// the neighbour chunks sharing the modified border are flagged as changed too
+	void setVoxel(glm::ivec3 worldPosition, Voxel voxel);
+
+	// the load, setup, rebuild and unload stages run their chunks in parallel when a scheduler is set
+	void setTaskScheduler(TaskScheduler* taskScheduler) { _taskScheduler = taskScheduler; }
+
+	// the chunks leaving the visibility radius are stored there and loaded back from it instead of being generated again,
+	// so the edits survive, the world does not own it but collects its garbage as the chunks stream out
+	void setFarStorage(VoxelDag* farStorage) { _farStorage = farStorage; }
+	// replaced stored chunks before the far storage garbage is collected, a quarter of the stored chunks when more
+	static const size_t FarStorageMinCollectCount = 64;
+
+	// stages with a per frame budget, the chunks left over wait in their priority queue for the next frames
+	enum class Stage
+	{
+		load = 0,
+		setup,
+		rebuild,
+		NUM_STAGES
+	};
+
+	// 0 means no limit, a stage always runs at least one batch (one chunk per worker) so that it never stalls
+	struct StageBudget
+	{
+		uint32_t maxChunkCount = 0;
+		float maxMilliseconds = 0.0f;
+	};
+
+	// what the last update did
+	struct StageStats
+	{
+		uint32_t processedCount = 0;
+		uint32_t deferredCount = 0;
+		float milliseconds = 0.0f;
+	};
+
+	void setStageBudget(Stage stage, StageBudget budget) { _stageBudgets[(size_t)stage] = budget; }
+	StageBudget getStageBudget(Stage stage) const { return _stageBudgets[(size_t)stage]; }
+	const StageStats& getStageStats(Stage stage) const { return _stageStats[(size_t)stage]; }
+
 private:
-	glm::vec3 _cameraPos;
-	glm::vec3 _cameraView;
+	ChunkMap _chunkMap;
+	// highest revision of the destroyed chunks, the next chunk created starts above it
+	uint32_t _lastRevision = 0;
+	// slots of the destroyed chunks, reused before the store grows
+	std::vector<ChunkHandle> _freeHandles;
+
+	ChunkGenerator _chunkGenerator;
+
+	glm::vec3 _cameraPos{};
+	glm::vec3 _cameraView{};
+
+	// the lists only hold handles, the chunk state flags live in the store
+	// destroyChunk removes a chunk from the queues, the other lists are rebuilt or cleared every update
+	// they keep their capacity from frame to frame, once warm an update does not allocate outside of the task scheduler
+	// the budgeted stages pop their chunks by priority : in view first, then the closest
+	ChunkQueue _loadList;
+	ChunkQueue _setupList;
+	ChunkQueue _rebuildList;
+	std::vector<ChunkHandle> _flagsList;
+	std::vector<ChunkHandle> _unloadList;
+	std::vector<ChunkHandle> _visibilityList;
 
-	std::vector<Chunk> _loadList;
-	std::vector<Chunk> _setupList;
-	std::vector<Chunk> _rebuildList;
-	std::vector<Chunk> _flagsList;
-	std::vector<Chunk> _unloadList;
-	std::vector<Chunk> _visibilityList;
+	bool _forceVisibilityUpdate = true;
 
-	bool _forceVisibilityUpdate;
+	TaskScheduler* _taskScheduler = nullptr;
+	VoxelDag* _farStorage = nullptr;
+
+	std::array<StageBudget, (size_t)Stage::NUM_STAGES> _stageBudgets{};
+	std::array<StageStats, (size_t)Stage::NUM_STAGES> _stageStats{};
+
+	// chunks processed by the last runStage
+	std::vector<ChunkHandle> _stageChunks;
+	// tasks of the last forEachChunk
+	std::vector<TaskScheduler::TaskHandle> _chunkTasks;
+
+	// pop chunks from queue and run work on them within the budget of stage, return how many were processed
+	uint32_t runStage(Stage stage, ChunkQueue& queue, const std::function<void(Chunk&)>& work);
+
+	// run work on count chunks, on the task scheduler if there is one, and wait for all of them
+	// work only touches the chunk it is given
+	void forEachChunk(const ChunkHandle* chunkList, size_t count, const std::function<void(Chunk&)>& work);
 
 	void updateAsyncChunker();
 	void updateLoadList();
@@ -70,4 +303,14 @@ private:
 	void updateVisibilityList(glm::vec3 cameraPos);
 
 	void updateRenderList();
+
+	// the neighbours meshed against a missing chunk must be meshed again once it is loaded, or against air once it is gone
+	void touchNeighbours(glm::ivec3 chunkCoord);
+
+	// distance to the camera in chunks, chunks out of the view cone come after all the ones in it
+	float getChunkPriority(ChunkHandle chunk) const;
+	bool isInView(glm::vec3 chunkCenter, glm::vec3 cameraChunkPosition) const;
+
+	static glm::ivec3 splitWorldPosition(glm::ivec3 worldPosition, glm::ivec3& localPosition);
+	static void generateGround(Chunk& chunk);
 };
\ No newline at end of file
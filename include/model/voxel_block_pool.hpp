@@ -0,0 +1,128 @@
+#pragma once
+
+// std
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+// fixed size blocks for the packed voxel indices of the chunks, in power of two size classes
+// every thread keeps a small cache of free blocks per class and only goes to the shared free lists, under a lock,
+// in batches when its cache runs empty or full; blocks are never given back to the system until trim
+// chunks streamed in and out reuse the same few block sizes, so once warm no chunk allocates from the heap
+class VoxelBlockPool
+{
+public:
+	// 1 word (8 bytes) up to 64K words (512 KB, the 16 bit indices of a 64^3 chunk)
+	static const uint32_t SizeClassCount = 17;
+
+	struct Stats
+	{
+		uint64_t allocations = 0;
+		uint64_t frees = 0;
+		// served by the calling thread cache, without any lock
+		uint64_t threadCacheHits = 0;
+		// blocks taken from the system, the pool holds them until trim
+		uint64_t systemAllocations = 0;
+		size_t reservedBytes = 0;
+		size_t usedBytes = 0;
+	};
+
+	// the pool every voxel storage allocates from, never destroyed so that chunks of static objects can still free
+	static VoxelBlockPool& get();
+
+	// delete copy constructors
+	VoxelBlockPool(const VoxelBlockPool&) = delete;
+	VoxelBlockPool& operator=(const VoxelBlockPool&) = delete;
+
+	// a block of at least wordCount words, its content is undefined
+	uint64_t* allocate(uint32_t wordCount);
+	// wordCount must be the one the block was allocated with
+	void free(uint64_t* block, uint32_t wordCount);
+
+	// give the blocks of the shared free lists back to the system, the thread caches keep theirs
+	// also flushes the cache of the calling thread
+	void trim();
+
+	// sums the counters of every thread, the threads may be allocating meanwhile
+	Stats getStats() const;
+
+	static uint32_t getSizeClass(uint32_t wordCount);
+	static uint32_t getClassWordCount(uint32_t sizeClass) { return 1u << sizeClass; }
+
+private:
+	// blocks kept per class by a thread, and moved at once between a thread and the shared lists
+	static const uint32_t ThreadCacheSize = 8;
+	static const uint32_t BatchSize = 4;
+
+	struct ThreadCache
+	{
+		std::array<std::array<uint64_t*, ThreadCacheSize>, SizeClassCount> blocks{};
+		std::array<uint32_t, SizeClassCount> blockCounts{};
+
+		// written by the owner thread only, read by getStats
+		std::atomic<uint64_t> allocations{ 0 };
+		std::atomic<uint64_t> frees{ 0 };
+		std::atomic<uint64_t> threadCacheHits{ 0 };
+		// a block freed by another thread than the one that allocated it makes these go negative
+		std::atomic<int64_t> usedWords{ 0 };
+
+		ThreadCache();
+		~ThreadCache();
+	};
+
+	// guards everything below, taken once per batch
+	mutable std::mutex mutex;
+	std::array<std::vector<uint64_t*>, SizeClassCount> freeBlocks;
+	std::vector<ThreadCache*> threadCaches;
+	// counters of the threads that exited
+	uint64_t retiredAllocations = 0;
+	uint64_t retiredFrees = 0;
+	uint64_t retiredThreadCacheHits = 0;
+	int64_t retiredUsedWords = 0;
+	uint64_t systemAllocations = 0;
+	size_t reservedWords = 0;
+
+	VoxelBlockPool() = default;
+
+	// nullptr once the cache of the calling thread is destroyed, at thread exit
+	static ThreadCache* getThreadCache();
+	void refill(ThreadCache& cache, uint32_t sizeClass);
+	// the cache keeps keepCount blocks of the class, the others go to the shared free list
+	void flush(ThreadCache& cache, uint32_t sizeClass, uint32_t keepCount);
+};
+
+// owning handle of a pooled block, what VoxelStorage keeps its packed indices in
+// copies allocate a block of their own, moves take the block over
+class VoxelBlock
+{
+public:
+	VoxelBlock() = default;
+	~VoxelBlock() { reset(); }
+
+	VoxelBlock(const VoxelBlock& other);
+	VoxelBlock& operator=(const VoxelBlock& other);
+	VoxelBlock(VoxelBlock&& other) noexcept;
+	VoxelBlock& operator=(VoxelBlock&& other) noexcept;
+
+	// wordCount words set to value, the block is kept when it is already in the right size class
+	void assign(uint32_t wordCount, uint64_t value);
+	// back to the pool
+	void reset();
+
+	uint64_t* data() { return words; }
+	const uint64_t* data() const { return words; }
+	uint64_t& operator[](uint32_t index) { return words[index]; }
+	uint64_t operator[](uint32_t index) const { return words[index]; }
+
+	uint32_t size() const { return wordCount; }
+	bool empty() const { return wordCount == 0; }
+	// bytes of the size class block held
+	size_t getMemoryUsage() const;
+
+private:
+	uint64_t* words = nullptr;
+	uint32_t wordCount = 0;
+};
@@ -0,0 +1,167 @@
+#pragma once
+
+// vulkan base
+#include "model/chunk_map.hpp"
+#include "model/voxel.hpp"
+
+// libs
+#include <glm/glm.hpp>
+
+// std
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// levels of an octree down to single voxels, for a cube of size voxels
+constexpr int getOctreeLevels(int size)
+{
+	int levels = 0;
+	while ((1 << levels) < size)
+		levels++;
+	return levels;
+}
+
+// sparse voxel octree of the chunks far from the camera, with identical subtrees stored once (a DAG)
+// every stored chunk is the root of an octree of ChunkLevels levels, uniform cubes are leaves holding
+// the voxel id directly and the inner nodes are shared by every chunk that contains the same subtree,
+// so flat ground, deep stone and sky cost a few nodes for the whole world
+// the chunks are keyed by coordinate like the chunk map, there is no bound on the stored region
+// reads may run on several threads at once, writes need the dag to themselves
+class VoxelDag
+{
+public:
+	// a leaf (LeafBit set, voxel id in the low bits) or the index of an inner node
+	using NodeRef = uint32_t;
+	static const NodeRef LeafBit = 0x80000000u;
+
+	VoxelDag() = default;
+
+	// delete copy constructors
+	VoxelDag(const VoxelDag&) = delete;
+	VoxelDag& operator=(const VoxelDag&) = delete;
+
+	// store the voxels of chunk at chunk.coord, replacing what was stored there
+	void storeChunk(const Chunk& chunk);
+	// write the stored voxels of chunkCoord into chunk, return false if nothing is stored there
+	bool loadChunk(glm::ivec3 chunkCoord, Chunk& chunk) const;
+	bool containsChunk(glm::ivec3 chunkCoord) const { return roots.find(chunkCoord) != InvalidChunkHandle; }
+	void removeChunk(glm::ivec3 chunkCoord) { if (roots.erase(chunkCoord)) replacedRootCount++; }
+
+	// air where no chunk is stored
+	Voxel getVoxel(glm::ivec3 worldPosition) const;
+
+	// call work(boxMin, boxSize, voxel) for every uniform cube of the stored chunks intersecting [regionMin, regionMax)
+	// cubes are given whole and may stick out of the region, air cubes are included
+	template<typename F>
+	void forEachBox(glm::ivec3 regionMin, glm::ivec3 regionMax, F&& work) const;
+
+	// drop the nodes no stored chunk reaches anymore, they pile up when stored chunks are overwritten or removed
+	// not called by the dag itself, the owner decides when from getReplacedRootCount
+	void collectGarbage();
+	// stored chunks overwritten or removed since the last collectGarbage, each may have left nodes behind
+	size_t getReplacedRootCount() const { return replacedRootCount; }
+
+	size_t getChunkCount() const { return roots.size(); }
+	size_t getNodeCount() const { return nodes.size(); }
+	// the nodes only, and everything including the deduplication table and the chunk roots
+	size_t getNodeMemoryUsage() const { return nodes.capacity() * sizeof(Node); }
+	size_t getMemoryUsage() const;
+
+	static bool isLeaf(NodeRef ref) { return (ref & LeafBit) != 0; }
+	static NodeRef makeLeaf(Voxel voxel) { return LeafBit | voxel.id; }
+	static Voxel getLeafVoxel(NodeRef ref) { return Voxel(static_cast<uint16_t>(ref & ~LeafBit)); }
+
+	// levels of a chunk octree, ChunkSize is 1 << ChunkLevels
+	static const int ChunkLevels = getOctreeLevels(Chunk::ChunkSize);
+	static_assert((1 << ChunkLevels) == Chunk::ChunkSize, "the chunk octree needs a power of two chunk size");
+
+private:
+	// children ordered by their x, y and z bits : child = x + 2 * y + 4 * z
+	struct Node
+	{
+		std::array<NodeRef, 8> children;
+		bool operator==(const Node& other) const { return children == other.children; }
+	};
+
+	struct NodeHash
+	{
+		size_t operator()(const Node& node) const;
+	};
+
+	std::vector<Node> nodes;
+	std::unordered_map<Node, NodeRef, NodeHash> nodeIndices;
+	// root of every stored chunk, a node ref never takes the value of InvalidChunkHandle
+	ChunkMap roots;
+	size_t replacedRootCount = 0;
+
+	// cube of size voxels at (x, y, z) in the decoded chunk
+	NodeRef build(const std::vector<Voxel>& voxels, int x, int y, int z, int size);
+	NodeRef intern(const Node& node);
+	void decode(NodeRef ref, int x, int y, int z, int size, std::vector<Voxel>& voxels) const;
+
+	template<typename F>
+	void forEachBox(NodeRef ref, glm::ivec3 boxMin, int size, glm::ivec3 regionMin, glm::ivec3 regionMax, F& work) const;
+};
+
+template<typename F>
+void VoxelDag::forEachBox(glm::ivec3 regionMin, glm::ivec3 regionMax, F&& work) const
+{
+	// chunks of the region, rounded outwards
+	glm::ivec3 chunkMin, chunkMax;
+	size_t regionChunkCount = 1;
+	for (int axis = 0; axis < 3; axis++)
+	{
+		if (regionMax[axis] <= regionMin[axis])
+			return;
+
+		chunkMin[axis] = regionMin[axis] >= 0 ? regionMin[axis] / Chunk::ChunkSize : (regionMin[axis] + 1) / Chunk::ChunkSize - 1;
+		chunkMax[axis] = regionMax[axis] > 0 ? (regionMax[axis] - 1) / Chunk::ChunkSize : regionMax[axis] / Chunk::ChunkSize - 1;
+		// stop counting once it is over the stored chunks, a huge region would overflow the count
+		if (regionChunkCount <= roots.size())
+			regionChunkCount *= static_cast<size_t>(chunkMax[axis] - chunkMin[axis]) + 1;
+	}
+
+	// a small region looks its chunks up, a large one walks the stored chunks
+	if (regionChunkCount <= roots.size())
+	{
+		for (int z = chunkMin.z; z <= chunkMax.z; z++)
+			for (int y = chunkMin.y; y <= chunkMax.y; y++)
+				for (int x = chunkMin.x; x <= chunkMax.x; x++)
+				{
+					NodeRef root = roots.find(glm::ivec3(x, y, z));
+					if (root != InvalidChunkHandle)
+						forEachBox(root, glm::ivec3(x, y, z) * Chunk::ChunkSize, Chunk::ChunkSize, regionMin, regionMax, work);
+				}
+		return;
+	}
+
+	roots.forEach([&](glm::ivec3 chunkCoord, NodeRef root) {
+		forEachBox(root, chunkCoord * Chunk::ChunkSize, Chunk::ChunkSize, regionMin, regionMax, work);
+	});
+}
+
+template<typename F>
+void VoxelDag::forEachBox(NodeRef ref, glm::ivec3 boxMin, int size, glm::ivec3 regionMin, glm::ivec3 regionMax, F& work) const
+{
+	for (int axis = 0; axis < 3; axis++)
+	{
+		if (boxMin[axis] + size <= regionMin[axis] || boxMin[axis] >= regionMax[axis])
+			return;
+	}
+
+	if (isLeaf(ref))
+	{
+		work(boxMin, size, getLeafVoxel(ref));
+		return;
+	}
+
+	int half = size / 2;
+	const Node& node = nodes[ref];
+	for (int child = 0; child < 8; child++)
+	{
+		glm::ivec3 childMin = boxMin + glm::ivec3(child & 1, (child >> 1) & 1, (child >> 2) & 1) * half;
+		forEachBox(node.children[child], childMin, half, regionMin, regionMax, work);
+	}
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+// libs
+#include <glm/glm.hpp>
+
+// std
+#include <cstdint>
+
+// order of the voxels of a chunk in memory
+//   linear : x first, then y, then z, neighbours along y and z are a row and a slice away
+//   morton : the bits of x, y and z interleaved (z-order curve), every 2x2x2 block, then every 4x4x4 block... is contiguous
+enum class VoxelLayout
+{
+	linear,
+	morton
+};
+
+// index of a voxel of a chunk of Size^3 voxels and back, the layout is a compile time choice
+template<VoxelLayout Layout, int Size>
+struct VoxelIndexer;
+
+template<int Size>
+struct VoxelIndexer<VoxelLayout::linear, Size>
+{
+	static constexpr int getIndex(int x, int y, int z) { return x + Size * (y + Size * z); }
+	static glm::ivec3 getPosition(int index) { return glm::ivec3(index % Size, (index / Size) % Size, index / (Size * Size)); }
+};
+
+template<int Size>
+struct VoxelIndexer<VoxelLayout::morton, Size>
+{
+	static_assert(Size > 0 && (Size & (Size - 1)) == 0 && Size <= 1024, "morton order needs a power of two size of at most 1024");
+
+	static constexpr int getIndex(int x, int y, int z) { return static_cast<int>(spreadBits(x) | (spreadBits(y) << 1) | (spreadBits(z) << 2)); }
+	static glm::ivec3 getPosition(int index) { return glm::ivec3(compactBits(index), compactBits(index >> 1), compactBits(index >> 2)); }
+
+	// 10 bits spread to every third bit, and back
+	static constexpr uint32_t spreadBits(uint32_t value)
+	{
+		value &= 0x000003FF;
+		value = (value | (value << 16)) & 0x030000FF;
+		value = (value | (value << 8)) & 0x0300F00F;
+		value = (value | (value << 4)) & 0x030C30C3;
+		value = (value | (value << 2)) & 0x09249249;
+		return value;
+	}
+
+	static constexpr int compactBits(uint32_t value)
+	{
+		value &= 0x09249249;
+		value = (value | (value >> 2)) & 0x030C30C3;
+		value = (value | (value >> 4)) & 0x0300F00F;
+		value = (value | (value >> 8)) & 0x030000FF;
+		value = (value | (value >> 16)) & 0x000003FF;
+		return static_cast<int>(value);
+	}
+};
@@ -3,14 +3,20 @@
 // vulkan base
 #include "vvb_pipeline.hpp"
 #include "vvb_mesh.hpp"
+#include "mesher/chunk_mesher.hpp"
+#include "mesher/async_chunk_mesher.hpp"
+#include "job/task_scheduler.hpp"
 #include "model/voxel.hpp"
 
 // libs
 #include "GLFW/glfw3.h"
 
 // std
+#include <array>
+#include <chrono>
 #include <vector>
 #include <memory>
+#include <unordered_map>
 
 
 class VoxelRenderSystem
@@ -28,6 +34,15 @@ public:
 	void update(glm::vec3 cameraPos, glm::vec3 cameraView);
 	void render(VkCommandBuffer commandBuffer, VkDescriptorSet descriptorSet);
 
+	// switch the chunk mesher at runtime, meshes are regenerated with the new one
+	void setMesherType(ChunkMesher::Type type);
+	ChunkMesher::Type getMesherType() const { return mesherType; }
+
+	// time from the creation of the system to the first update where every chunk of the render list
+	// is drawn and nothing is left to load or set up, negative until then
+	float getWorldLoadMilliseconds() const { return worldLoadMilliseconds; }
+	bool isWorldLoaded() const { return worldLoadMilliseconds >= 0.0f; }
+
 private:
 	// pipeline
 	VkPipelineLayout pipelineLayout;
@@ -40,7 +55,92 @@ private:
 	void createPipelineLayout(VkDescriptorSetLayout descriptorSetLayout);
 	void createPipelines(VkRenderPass renderpass);
 
+	// vertices of a section in the chunk mesh, the capacity leaves room for the section to grow
+	struct SectionRange
+	{
+		uint32_t firstVertex = 0;
+		uint32_t vertexCapacity = 0;
+	};
+
+	// gpu mesh of a chunk, revision is the one of the chunk when it was meshed
+	// firstRevision is the one the chunk was created with, results below it were meshed for an earlier chunk at that coordinate
+	// submittedRevision is the one of the job still running on the workers, if any
+	// staleSections are the sections sent to the workers and not patched in yet, every job re-meshes them
+	// so that an older job finishing late and thrown away loses nothing
+	// range is the vertices of the chunk drawn from the chunk buffer, invalid until the first mesh is uploaded
+	// a new mesh or a patched one goes to pendingRange and replaces range once the upload queue completed uploadTicket,
+	// the range being drawn is never written
+	// vertices are the ones of the latest range, pending or not, laid out as its sections : a patch rewrites some
+	// sections of this copy and uploads it whole to a new range
+	struct ChunkMesh
+	{
+		VvbChunkBuffer::Range range;
+		std::array<SectionRange, Chunk::SectionCount> sections{};
+		VvbChunkBuffer::Range pendingRange;
+		std::array<SectionRange, Chunk::SectionCount> pendingSections{};
+		uint64_t uploadTicket = 0;
+		std::vector<uint8_t> vertices;
+		uint64_t staleSections = 0;
+		uint32_t firstRevision = 0;
+		uint32_t revision = 0;
+		uint32_t submittedRevision = 0;
+		bool isPending = false;
+		// meshed without a face to show, there is no range to draw
+		bool isEmpty = false;
+
+		bool hasMesh() const { return range.isValid() || pendingRange.isValid() || isEmpty; }
+	};
+
+	// send the new and changed chunks of the render list to the workers, upload the finished meshes
+	// and drop the meshes of unloaded chunks
+	// an edited chunk only sends its dirty sections, they are patched in place in its vertex buffer
+	void updateChunkMeshes();
+	// a new range of the chunk buffer for every section of the chunk, drawn once its upload completed
+	// a mesh without vertices gets no range and the chunk is drawn no more
+	void uploadChunkMesh(ChunkMesh& chunkMesh, const ChunkMeshData& meshData);
+	// the sections of meshData written over the latest mesh of the chunk, uploaded to a new range with the same layout
+	// and drawn once its upload completed, false when a section outgrew its range and nothing was written
+	bool patchChunkMesh(ChunkMesh& chunkMesh, const ChunkMeshData& meshData);
+	void uploadPendingRange(ChunkMesh& chunkMesh);
+	// the chunks to draw this frame, grouped by chunk buffer page
+	void collectChunkDraws();
+	void drawChunks(VkCommandBuffer commandBuffer);
+
+	// a removed range may still be drawn by a frame in flight or written by an upload,
+	// it is freed MAX_FRAMES_IN_FLIGHT updates later once uploadTicket completed
+	void retireRange(VvbChunkBuffer::Range& range, uint64_t uploadTicket = 0);
+	void releaseRetiredRanges();
+	void updateWorldLoadTime();
+
+	ChunkMesher::Type mesherType = ChunkMesher::Type::binary;
+
 	World world{};
-	std::unique_ptr<VvbMesh> chunk;
+	std::unique_ptr<VvbQuadIndexBuffer> quadIndexBuffer;
+	std::unique_ptr<VvbChunkBuffer> chunkBuffer;
+	std::unordered_map<glm::ivec3, ChunkMesh> chunkMeshes;
+
+	struct ChunkDraw
+	{
+		glm::ivec3 coord;
+		VvbChunkBuffer::Range range;
+	};
+	std::vector<ChunkDraw> chunkDraws;
+
+	struct RetiredRange
+	{
+		uint64_t updateCount;
+		uint64_t uploadTicket;
+		VvbChunkBuffer::Range range;
+	};
+	std::vector<RetiredRange> retiredRanges;
+	uint64_t updateCount = 0;
+
+	std::chrono::steady_clock::time_point createTime = std::chrono::steady_clock::now();
+	float worldLoadMilliseconds = -1.0f;
+
+	// world stages and meshing run on the workers, only the uploads stay on the render thread
+	TaskScheduler taskScheduler;
+	AsyncChunkMesher asyncMesher{ taskScheduler };
+	std::vector<AsyncChunkMesher::Result> meshResults;
 };
 
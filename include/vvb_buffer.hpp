@@ -13,10 +13,10 @@ public:
 	VvbBuffer(const VvbBuffer&) = delete;
 	VvbBuffer operator=(const VvbBuffer&) = delete;
 
-	VkResult map(VkDeviceSize size = VK_WHOLE_SIZE, VkDeviceSize offset = 0);
+	VkResult map(VkDeviceSize offset = 0);
 	void unmap();
 
-	void write(void* data, VkDeviceSize size = VK_WHOLE_SIZE, VkDeviceSize offset = 0);
+	void write(const void* data, VkDeviceSize size = VK_WHOLE_SIZE, VkDeviceSize offset = 0);
 
 	VkBuffer getBuffer() const { return buffer; }
 	VkDeviceSize getSize() const { return bufferSize; }
@@ -30,7 +30,7 @@ private:
 
 	void* mapped = nullptr;
 	VkBuffer buffer = VK_NULL_HANDLE;
-	VkDeviceMemory memory = VK_NULL_HANDLE;
+	VvbMemoryAllocator::Allocation memory;
 
 
 	VkDeviceSize bufferSize;
@@ -2,6 +2,9 @@
 // vulkan base
 #include "vvb_window.hpp"
 #include "vvb_instance.hpp"
+#include "vvb_memory_allocator.hpp"
+#include "vvb_staging_buffer.hpp"
+#include "vvb_upload_queue.hpp"
 
 // libs
 #define GLFW_INCLUDE_VULKAN
@@ -15,6 +18,7 @@
 #include <glm/gtc/matrix_transform.hpp>
 
 // std
+#include <memory>
 #include <optional>
 
 class VvbDevice
@@ -56,20 +60,32 @@ public:
 	VkQueue getPresentQueue() { return presentQueue; }
 	VkQueue getTransferQueue() { return transferQueue; }
 	QueueFamilyIndices getQueueFamilyIndices() { return indices; }
+	VvbMemoryAllocator& getMemoryAllocator() { return *memoryAllocator; }
 
 	// command pools
 	VkCommandPool getGraphicsCommandPool() { return graphicsCommandPool; }
 	VkCommandPool getTransferCommandPool() { return transferCommandPool; }
 
-	// buffer utils
-	void createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, VkDeviceMemory& bufferMemory);
-	void copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size);
+	// buffer utils, the memory of the buffers is sub-allocated from the blocks of the memory allocator
+	// the buffers are exclusive to a queue family, copies to them go through the upload queue
+	void createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, VvbMemoryAllocator::Allocation& bufferMemory);
+	void destroyBuffer(VkBuffer buffer, VvbMemoryAllocator::Allocation& bufferMemory);
+
+	// staging, data is written in the staging buffer of the frame then copied to the buffer or the image
+	// uploadToBuffer waits for the copy, the upload queue is for uploads that don't have to
+	VvbStagingBuffer& getStagingBuffer() { return *stagingBuffer; }
+	VvbUploadQueue& getUploadQueue() { return *uploadQueue; }
+	// the fence of frameIndex signaled : the staging partition of the frame is reused
+	void beginFrame(uint32_t frameIndex);
+	void uploadToBuffer(const void* data, VkDeviceSize size, VkBuffer dstBuffer, VkDeviceSize dstOffset = 0);
+	// image in VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL
+	void uploadToImage(const void* data, VkDeviceSize size, VkImage image, uint32_t width, uint32_t height);
 
 	// image utils
 	void createImage(uint32_t width, uint32_t height, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage& image, VkDeviceMemory& imageMemory, uint32_t mipLevels, VkSampleCountFlagBits numSamples);
 	VkImageView createImageView(VkImage image, VkFormat format, VkImageAspectFlags aspectFlags, uint32_t mipLevels);
 	void transitionImageLayout(VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout, uint32_t mipLevels);
-	void copyBufferToImage(VkBuffer buffer, VkImage image, uint32_t width, uint32_t height);
+	void copyBufferToImage(VkBuffer buffer, VkImage image, uint32_t width, uint32_t height, VkDeviceSize bufferOffset = 0);
 	bool hasStencilComponent(VkFormat format);
 	void generateMipmaps(VkImage image, VkFormat imageFormat, uint32_t width, uint32_t height, uint32_t mipLevels);
 
@@ -101,13 +117,36 @@ private:
 	QueueFamilyIndices indices;
 	void createDevice();
 
+	// memory
+	std::unique_ptr<VvbMemoryAllocator> memoryAllocator;
+	std::unique_ptr<VvbStagingBuffer> stagingBuffer;
+	std::unique_ptr<VvbUploadQueue> uploadQueue;
+
+	// host visible buffer for an upload too large for the staging buffer, freed by the caller
+	void* createTemporaryStagingBuffer(VkDeviceSize size, VkBuffer& buffer, VvbMemoryAllocator::Allocation& bufferMemory);
+
 	// command pools
 	VkCommandPool graphicsCommandPool;
 	VkCommandPool transferCommandPool;
 	void createCommandPools();
 
-	// TODO : take in count the poolCreator of the command
-	VkCommandBuffer beginSingleTimeCommands();
-	void endSingleTimeCommands(VkCommandBuffer commandBuffer);
+	// one command buffer per pool for the copies and layout transitions that are waited on right away,
+	// recorded again every time instead of allocated and freed, and waited on with its own fence
+	// rather than the whole queue, which may be running upload batches
+	struct SingleTimeCommands
+	{
+		VkCommandPool commandPool = VK_NULL_HANDLE;
+		VkQueue queue = VK_NULL_HANDLE;
+		VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+		VkFence fence = VK_NULL_HANDLE;
+	};
+	SingleTimeCommands graphicsCommands;
+	SingleTimeCommands transferCommands;
+
+	void createSingleTimeCommands(SingleTimeCommands& commands, VkCommandPool commandPool, VkQueue queue);
+	void destroySingleTimeCommands(SingleTimeCommands& commands);
+	VkCommandBuffer beginSingleTimeCommands(SingleTimeCommands& commands);
+	// submit and wait for the commands
+	void endSingleTimeCommands(SingleTimeCommands& commands);
 };
 
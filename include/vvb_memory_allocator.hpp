@@ -0,0 +1,88 @@
+#pragma once
+
+// vulkan base
+#include "memory/tlsf_allocator.hpp"
+
+// libs
+#include "vulkan/vulkan_core.h"
+
+// std
+#include <memory>
+#include <vector>
+
+// device memory for the buffers, taken from large blocks (vkAllocateMemory) per memory type
+// and sub-allocated with a tlsf allocator : thousands of chunk buffers share a handful of allocations
+// instead of hitting maxMemoryAllocationCount, and allocating a range costs no driver call
+// host visible blocks are mapped once for their whole life, their buffers get a pointer into the mapping
+// only buffers live in the blocks, so bufferImageGranularity never comes into play
+class VvbMemoryAllocator
+{
+public:
+	static const VkDeviceSize DefaultBlockSize = 64ull * 1024 * 1024;
+
+	struct Allocation
+	{
+		VkDeviceMemory memory = VK_NULL_HANDLE;
+		VkDeviceSize offset = 0;
+		VkDeviceSize size = 0;
+		// null when the memory is not host visible
+		void* mapped = nullptr;
+
+		uint32_t memoryType = 0;
+		uint32_t blockIndex = 0;
+		// invalid for the allocation of a dedicated block
+		TlsfAllocator::Allocation range;
+
+		bool isValid() const { return memory != VK_NULL_HANDLE; }
+	};
+
+	struct Stats
+	{
+		uint32_t blockCount = 0;
+		// blocks holding a single allocation too large to share one
+		uint32_t dedicatedBlockCount = 0;
+		uint32_t allocationCount = 0;
+		VkDeviceSize reservedBytes = 0;
+		VkDeviceSize usedBytes = 0;
+		// 1 - largest free range / free bytes, summed over the shared blocks
+		float fragmentation = 0.0f;
+	};
+
+	VvbMemoryAllocator(VkDevice device, VkPhysicalDevice physicalDevice, VkDeviceSize blockSize = DefaultBlockSize);
+	// every allocation must have been freed
+	~VvbMemoryAllocator();
+
+	// delete copy constructors
+	VvbMemoryAllocator(const VvbMemoryAllocator&) = delete;
+	VvbMemoryAllocator& operator=(const VvbMemoryAllocator&) = delete;
+
+	// memoryType is an index from findMemoryType, throws when the device runs out of memory
+	Allocation allocate(const VkMemoryRequirements& requirements, uint32_t memoryType);
+	void free(Allocation& allocation);
+
+	Stats getStats() const;
+
+private:
+	struct Block
+	{
+		VkDeviceMemory memory = VK_NULL_HANDLE;
+		void* mapped = nullptr;
+		TlsfAllocator ranges;
+		// a dedicated block holds one allocation at offset 0 and leaves ranges empty,
+		// tlsf could not always fit a range as large as the block
+		bool isDedicated = false;
+		VkDeviceSize dedicatedSize = 0;
+
+		Block(VkDeviceSize size) : ranges(size) {}
+	};
+
+	VkDevice device;
+	VkPhysicalDeviceMemoryProperties memoryProperties{};
+	VkDeviceSize blockSize;
+
+	// per memory type, a freed block leaves a null slot that the next block of the type takes
+	std::vector<std::vector<std::unique_ptr<Block>>> blocks;
+
+	uint32_t createBlock(uint32_t memoryType, VkDeviceSize size, bool isDedicated);
+	void destroyBlock(uint32_t memoryType, uint32_t blockIndex);
+};
@@ -4,9 +4,11 @@
 #include "vvb_buffer.hpp"
 #include "vvb_texture.hpp"
 #include "model/voxel.hpp"
+#include "memory/tlsf_allocator.hpp"
 
 //std
 #include <array>
+#include <cassert>
 #include <memory>
 
 // glm
@@ -25,34 +27,128 @@ struct Vertex
 	static std::array<VkVertexInputAttributeDescription, 3> getAttributeDescriptions();
 };
 
-class VvbMesh
+struct ChunkMeshData;
+
+// 8 byte voxel vertex, decoded in voxel.vert
+//   x : chunk local position, 7 bits each for x, y and z (corners go up to ChunkSize included)
+//       then the face normal index (3 bits) and the ambient occlusion level (2 bits)
+//   y : voxel id (16 bits), used as block / texture id
+struct PackedVertex
+{
+	uint32_t data;
+	uint32_t voxelId;
+
+	// inline so that the cpu side meshers do not depend on the vulkan objects
+	static PackedVertex pack(glm::ivec3 position, uint32_t normal, uint32_t ao, uint16_t voxelId)
+	{
+		assert(position.x >= 0 && position.x < 128 && position.y >= 0 && position.y < 128 && position.z >= 0 && position.z < 128 && "position out of the packed range");
+		return PackedVertex{
+			(uint32_t)position.x | ((uint32_t)position.y << 7) | ((uint32_t)position.z << 14) | ((normal & 0x7u) << 21) | ((ao & 0x3u) << 24),
+			voxelId
+		};
+	}
+
+	static VkVertexInputBindingDescription getBindingDescription();
+	static std::array<VkVertexInputAttributeDescription, 1> getAttributeDescriptions();
+};
+
+static_assert(sizeof(PackedVertex) == 8, "packed vertex must stay 8 bytes");
+static_assert(Chunk::ChunkSize < 128, "packed vertex positions are 7 bits");
+
+enum class VertexFormat
+{
+	Standard,	// Vertex
+	Packed		// PackedVertex
+};
+
+// index buffer shared by every chunk mesh : chunk meshes are lists of quads (4 vertices each)
+// so the indices 0,1,2,2,3,0 + 4 * quad are the same for all of them and only built once
+// 16 bit indices address 65536 vertices, bigger meshes are drawn in several batches with a vertex offset
+class VvbQuadIndexBuffer
 {
 public:
-	VvbMesh(VvbDevice& device, Chunk chunk);
-	~VvbMesh();
+	static const uint32_t MaxQuadsPerDraw = 65536 / 4;
+
+	VvbQuadIndexBuffer(VvbDevice& vvbDevice, uint32_t maxQuadCount);
+	~VvbQuadIndexBuffer();
 
 	// delete copy constructors
-	VvbMesh(const VvbMesh&) = delete;
-	VvbMesh& operator=(const VvbMesh&) = delete;
+	VvbQuadIndexBuffer(const VvbQuadIndexBuffer&) = delete;
+	VvbQuadIndexBuffer& operator=(const VvbQuadIndexBuffer&) = delete;
 
-	void generateGeometry(Chunk chunk, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices);
+	void bind(VkCommandBuffer commandBuffer);
 
-	void createVertexBuffer(std::vector<Vertex>& vertices);
-	void createIndexBuffer(std::vector<uint32_t>& indices);
+	uint32_t getQuadCount() const { return quadCount; }
 
-	void bind(VkCommandBuffer commandBuffer);
-	void draw(VkCommandBuffer commandBuffer);
+private:
+	// vulkan base ref
+	VvbDevice& vvbDevice;
+
+	std::unique_ptr<VvbBuffer> indexBuffer;
+	uint32_t quadCount = 0;
+};
+
+// one large vertex buffer shared by every chunk mesh, each chunk gets a range of vertices in it
+// so that a frame binds it once and draws every chunk with a vertex offset into it
+// the ranges are handed out by a tlsf allocator, a new page is added in the rare case the first one is full
+// and the draws are grouped by page : a bind per page, almost always a single one
+class VvbChunkBuffer
+{
+public:
+	static const uint32_t NullPage = UINT32_MAX;
+	static const VkDeviceSize DefaultPageSize = 64ull * 1024 * 1024;
+
+	struct Range
+	{
+		uint32_t page = NullPage;
+		uint32_t firstVertex = 0;
+		uint32_t vertexCount = 0;
+		TlsfAllocator::Allocation allocation;
+
+		bool isValid() const { return page != NullPage; }
+	};
+
+	// vertexSize must be a power of two so that every range starts on a whole vertex
+	VvbChunkBuffer(VvbDevice& vvbDevice, VkDeviceSize vertexSize, VkDeviceSize pageSize = DefaultPageSize);
+	~VvbChunkBuffer();
+
+	// delete copy constructors
+	VvbChunkBuffer(const VvbChunkBuffer&) = delete;
+	VvbChunkBuffer& operator=(const VvbChunkBuffer&) = delete;
+
+	// the content of a new range is undefined until written, throws when a page can't hold it
+	Range allocate(uint32_t vertexCount);
+	// the range may still be drawn by a frame in flight, the caller waits for it to end
+	void free(Range& range);
+
+	// overwrite count vertices of the range from firstVertex, the rest of the range is left as is
+	// the copy goes out with the next submit of the device upload queue, and is drawable once its ticket completes
+	void writeVertices(const Range& range, const void* vertices, uint32_t firstVertex, uint32_t count);
+
+	void bind(VkCommandBuffer commandBuffer, uint32_t page);
+	// with the page of the range and the VvbQuadIndexBuffer bound
+	void draw(VkCommandBuffer commandBuffer, const Range& range);
+
+	uint32_t getPageCount() const { return static_cast<uint32_t>(pages.size()); }
+	VkDeviceSize getVertexSize() const { return vertexSize; }
 
 private:
+	struct Page
+	{
+		std::unique_ptr<VvbBuffer> vertexBuffer;
+		TlsfAllocator ranges;
+
+		Page(VkDeviceSize size) : ranges(size) {}
+	};
+
 	// vulkan base ref
 	VvbDevice& vvbDevice;
 
-	std::unique_ptr<VvbBuffer> vertexBuffer;
-	uint32_t vertexCount = 0;
+	VkDeviceSize vertexSize;
+	VkDeviceSize pageSize;
+	std::vector<std::unique_ptr<Page>> pages;
 
-	bool hasIndexBuffer = false;
-	std::unique_ptr<VvbBuffer> indexBuffer;
-	uint32_t indexCount = 0;
+	void createPage();
 };
 
 // implementation of hash calculation for Vertex
@@ -2,6 +2,7 @@
 // vulkan base
 #include "vvb_buffer.hpp"
 #include "vvb_texture.hpp"
+#include "vvb_upload_queue.hpp"
 
 //std
 #include <array>
@@ -36,8 +37,9 @@ public:
 	VvbModel(const VvbModel&) = delete;
 	VvbModel& operator=(const VvbModel&) = delete;
 
-	void createVertexBuffer(std::vector<Vertex>& vertices);
-	void createIndexBuffer(std::vector<uint32_t>& indices);
+	// the buffers can be drawn once uploads is submitted
+	void createVertexBuffer(std::vector<Vertex>& vertices, VvbUploadBatch& uploads);
+	void createIndexBuffer(std::vector<uint32_t>& indices, VvbUploadBatch& uploads);
 	void createTexture(const std::string textureFile);
 
 	void bind(VkCommandBuffer commandBuffer);
@@ -63,7 +65,7 @@ private:
 	bool hasTexture = false;
 	std::unique_ptr<VvbTexture> texture;
 
-	void loadModel(const std::string modelFile);
+	void loadModel(const std::string modelFile, VvbUploadBatch& uploads);
 };
 
 // implementation of hash calculation for Vertex
@@ -1,6 +1,7 @@
 #pragma once
 // vulkan base
 #include "vvb_swap_chain.hpp"
+#include "vvb_mesh.hpp"
 
 // std
 #include <string>
@@ -15,7 +16,7 @@ enum class Primitive
 class VvbPipeline
 {
 public:
-	VvbPipeline(VvbDevice& vvbDevice, VkPipelineLayout pipelineLayout, VkRenderPass renderPass, const std::string& vertexFilepath, const std::string& fragmentFilepath, Primitive primitive = Primitive::TriangleList);
+	VvbPipeline(VvbDevice& vvbDevice, VkPipelineLayout pipelineLayout, VkRenderPass renderPass, const std::string& vertexFilepath, const std::string& fragmentFilepath, Primitive primitive = Primitive::TriangleList, VertexFormat vertexFormat = VertexFormat::Standard);
 	~VvbPipeline();
 
 	VkPipeline getVkPipeline() { return pipeline; }
@@ -28,7 +29,7 @@ private:
 	// vulkan base ref
 	VvbDevice& vvbDevice;
 
-	void createGraphicsPipeline(VkPipelineLayout pipelineLayout, VkRenderPass renderPass, const std::string& vertexFilepath, const std::string& fragmentFilepath, Primitive primitive);
+	void createGraphicsPipeline(VkPipelineLayout pipelineLayout, VkRenderPass renderPass, const std::string& vertexFilepath, const std::string& fragmentFilepath, Primitive primitive, VertexFormat vertexFormat);
 
 	static std::vector<char> readFile(const std::string& filePath);
 	VkShaderModule createShaderModule(const std::vector<char>& code);
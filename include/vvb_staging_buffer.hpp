@@ -0,0 +1,71 @@
+#pragma once
+
+// vulkan base
+#include "vvb_memory_allocator.hpp"
+
+// libs
+#include "vulkan/vulkan_core.h"
+
+// std
+#include <vector>
+
+class VvbDevice;
+
+// host visible buffer the uploads are written in before being copied to the device local buffers and images
+// created and mapped once, then cut in a partition per frame in flight : the uploads of a frame are
+// linearly allocated from its partition, which is reused as a whole once the fence of that frame signaled
+class VvbStagingBuffer
+{
+public:
+	static const VkDeviceSize DefaultPartitionSize = 16ull * 1024 * 1024;
+
+	struct Region
+	{
+		VkBuffer buffer = VK_NULL_HANDLE;
+		VkDeviceSize offset = 0;
+		VkDeviceSize size = 0;
+		void* mapped = nullptr;
+
+		bool isValid() const { return buffer != VK_NULL_HANDLE; }
+	};
+
+	struct Stats
+	{
+		uint64_t allocations = 0;
+		// uploads that did not fit in the partition of their frame
+		uint64_t overflows = 0;
+		VkDeviceSize peakPartitionUsage = 0;
+	};
+
+	VvbStagingBuffer(VvbDevice& vvbDevice, uint32_t partitionCount, VkDeviceSize partitionSize = DefaultPartitionSize);
+	~VvbStagingBuffer();
+
+	// delete copy constructors
+	VvbStagingBuffer(const VvbStagingBuffer&) = delete;
+	VvbStagingBuffer& operator=(const VvbStagingBuffer&) = delete;
+
+	// the partition of frameIndex is emptied, its fence must have signaled
+	void beginFrame(uint32_t frameIndex);
+
+	// invalid when the partition of the current frame has no room left
+	Region allocate(VkDeviceSize size, VkDeviceSize alignment = 16);
+
+	uint32_t getCurrentFrame() const { return currentPartition; }
+	VkDeviceSize getPartitionSize() const { return partitionSize; }
+	const Stats& getStats() const { return stats; }
+
+private:
+	// vulkan base ref
+	VvbDevice& vvbDevice;
+
+	VkBuffer buffer = VK_NULL_HANDLE;
+	VvbMemoryAllocator::Allocation memory;
+
+	VkDeviceSize partitionSize;
+	uint32_t partitionCount;
+	uint32_t currentPartition = 0;
+	// next free byte of the current partition, from its start
+	VkDeviceSize head = 0;
+
+	Stats stats;
+};
@@ -0,0 +1,137 @@
+#pragma once
+
+// vulkan base
+#include "vvb_memory_allocator.hpp"
+#include "vvb_staging_buffer.hpp"
+
+// libs
+#include "vulkan/vulkan_core.h"
+
+// std
+#include <deque>
+#include <vector>
+
+class VvbDevice;
+
+// uploads to device local buffers on the transfer queue without waiting for them
+// the copies recorded since the last submit go out together in one command buffer, a batch,
+// whose fence is polled by update : the ticket of a batch is complete once its buffers can be drawn
+// the buffers are exclusive to a queue family, so when transfer and graphics families differ the written
+// ranges are released by the transfer queue and acquired on the graphics queue before the batch completes
+class VvbUploadQueue
+{
+public:
+	VvbUploadQueue(VvbDevice& vvbDevice, VvbStagingBuffer& stagingBuffer);
+	// waits for the batches in flight
+	~VvbUploadQueue();
+
+	// delete copy constructors
+	VvbUploadQueue(const VvbUploadQueue&) = delete;
+	VvbUploadQueue& operator=(const VvbUploadQueue&) = delete;
+
+	// data is copied in the staging buffer right away and to dstBuffer with the next submit
+	// dstBuffer is read as vertices or indices once the ticket of the batch is complete
+	void upload(const void* data, VkDeviceSize size, VkBuffer dstBuffer, VkDeviceSize dstOffset = 0);
+
+	// send the uploads since the last submit in one batch, returns its ticket
+	// with nothing to send, the ticket of the last batch
+	uint64_t submit();
+
+	// poll the batches in flight, in submission order : acquire the ranges of the finished ones
+	// on the graphics queue, then recycle their command buffers and fences
+	void update();
+	void wait(uint64_t ticket);
+	// the staging partition of frameIndex is about to be reused, every batch reading it must be done
+	void waitForFrame(uint32_t frameIndex);
+
+	bool isComplete(uint64_t ticket) const { return ticket <= completedTicket; }
+	// ticket the uploads recorded now will complete with
+	uint64_t getNextTicket() const { return nextTicket; }
+
+private:
+	enum class BatchState
+	{
+		transferring,
+		acquiring
+	};
+
+	struct Copy
+	{
+		VkBuffer srcBuffer;
+		VkBuffer dstBuffer;
+		VkBufferCopy region;
+	};
+
+	// command buffers and fence are kept when the batch is recycled
+	struct Batch
+	{
+		uint64_t ticket = 0;
+		BatchState state = BatchState::transferring;
+		// bit per staging partition the copies read
+		uint32_t stagingFrames = 0;
+		std::vector<Copy> copies;
+
+		VkCommandBuffer transferCommandBuffer = VK_NULL_HANDLE;
+		VkCommandBuffer graphicsCommandBuffer = VK_NULL_HANDLE;
+		VkFence fence = VK_NULL_HANDLE;
+
+		// upload too large for the staging buffer, destroyed once the batch is done
+		std::vector<std::pair<VkBuffer, VvbMemoryAllocator::Allocation>> temporaryBuffers;
+	};
+
+	// vulkan base ref
+	VvbDevice& vvbDevice;
+	VvbStagingBuffer& stagingBuffer;
+
+	bool isOwnershipTransferred;
+
+	// copies of the next batch, and the temporary buffers they read
+	std::vector<Copy> copies;
+	std::vector<std::pair<VkBuffer, VvbMemoryAllocator::Allocation>> temporaryBuffers;
+	uint32_t stagingFrames = 0;
+
+	// kept to not allocate on every batch
+	std::vector<VkBufferCopy> regions;
+	std::vector<VkBufferMemoryBarrier> barriers;
+
+	std::deque<Batch> batches;
+	std::vector<Batch> freeBatches;
+
+	uint64_t nextTicket = 1;
+	uint64_t completedTicket = 0;
+
+	Batch createBatch();
+	void recordTransfer(Batch& batch);
+	void recordAcquire(Batch& batch);
+	void recycleBatch(Batch& batch);
+	// a barrier per range written by the batch
+	void collectBarriers(const Batch& batch, VkAccessFlags srcAccessMask, VkAccessFlags dstAccessMask, uint32_t srcQueueFamily, uint32_t dstQueueFamily);
+};
+
+// uploads of one bulk load, a model or a set of buffers created together, waited on once
+// instead of a submit and a wait per buffer : every copy goes out in one batch of the upload queue
+class VvbUploadBatch
+{
+public:
+	explicit VvbUploadBatch(VvbDevice& vvbDevice);
+	// submits and waits for the uploads not submitted yet
+	~VvbUploadBatch();
+
+	// delete copy constructors
+	VvbUploadBatch(const VvbUploadBatch&) = delete;
+	VvbUploadBatch& operator=(const VvbUploadBatch&) = delete;
+
+	// dstBuffer can't be read before submit returned
+	void upload(const void* data, VkDeviceSize size, VkBuffer dstBuffer, VkDeviceSize dstOffset = 0);
+	// send the uploads in one batch and wait for it
+	void submit();
+
+	uint32_t getCopyCount() const { return copyCount; }
+
+private:
+	// vulkan base ref
+	VvbUploadQueue& uploadQueue;
+
+	uint32_t copyCount = 0;
+	bool isSubmitted = true;
+};
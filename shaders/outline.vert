@@ -1,8 +1,7 @@
 #version 450
 
-layout(location = 0) in vec3 inPosition;
-layout(location = 1) in vec3 inColor;
-layout(location = 2) in vec2 inTexCoord;
+// packed vertex, see PackedVertex in vvb_mesh.hpp
+layout(location = 0) in uvec2 inPacked;
 
 layout(location = 0) out vec3 fragColor;
 layout(location = 1) out vec2 fragTexCoord;
@@ -21,8 +20,10 @@ layout(binding = 0) uniform UniformBufferObject {
 
 void main()
 {
+    vec3 position = vec3(inPacked.x & 0x7Fu, (inPacked.x >> 7) & 0x7Fu, (inPacked.x >> 14) & 0x7Fu);
+
     gl_PointSize = 10.0;
-    gl_Position = ubo.proj * ubo.view * pushConstants.transform_matrix * vec4(inPosition, 1.0);
-    fragColor = inColor;
-    fragTexCoord = inTexCoord;
-}
\ No newline at end of file
+    gl_Position = ubo.proj * ubo.view * pushConstants.transform_matrix * vec4(position, 1.0);
+    fragColor = vec3(0.0);
+    fragTexCoord = vec2(0.0);
+}
@@ -1,11 +1,9 @@
 #version 450
 
-layout(location = 0) in vec3 inPosition;
-layout(location = 1) in vec3 inColor;
-layout(location = 2) in vec2 inTexCoord;
+// packed vertex, see PackedVertex in vvb_mesh.hpp
+layout(location = 0) in uvec2 inPacked;
 
 layout(location = 0) out vec3 fragColor;
-layout(location = 1) out vec2 fragTexCoord;
 
 layout( push_constant ) uniform constants
 {
@@ -19,9 +17,26 @@ layout(binding = 0) uniform UniformBufferObject {
     mat4 proj;
 } ubo;
 
+// indexed by ChunkMesher::Face : front, back, left, right, top, bottom
+const float faceShades[6] = float[](0.8, 0.8, 0.7, 0.7, 1.0, 0.5);
+
+// indexed by Voxel::Type
+const vec3 voxelColors[6] = vec3[](
+    vec3(1.0, 0.0, 1.0),    // air, never meshed
+    vec3(0.45, 0.3, 0.18),  // dirt
+    vec3(0.3, 0.6, 0.2),    // grass
+    vec3(0.5, 0.5, 0.5),    // stone
+    vec3(1.0, 0.0, 1.0),    // unused
+    vec3(0.85, 0.8, 0.55)   // sand
+);
+
 void main() 
 {
-    gl_Position = ubo.proj * ubo.view * pushConstants.transform_matrix * vec4(inPosition, 1.0);
-    fragColor = inColor;
-    fragTexCoord = inTexCoord;
-}
\ No newline at end of file
+    vec3 position = vec3(inPacked.x & 0x7Fu, (inPacked.x >> 7) & 0x7Fu, (inPacked.x >> 14) & 0x7Fu);
+    uint normal = (inPacked.x >> 21) & 0x7u;
+    uint ao = (inPacked.x >> 24) & 0x3u;
+    uint voxelId = inPacked.y & 0xFFFFu;
+
+    gl_Position = ubo.proj * ubo.view * pushConstants.transform_matrix * vec4(position, 1.0);
+    fragColor = voxelColors[min(voxelId, 5u)] * faceShades[normal] * (1.0 - 0.2 * float(ao));
+}
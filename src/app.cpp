@@ -77,6 +77,7 @@ void App::run()
 	KeyboardController keyboardController;
 
 	auto currentTime = std::chrono::high_resolution_clock::now();
+	bool isWorldLoadLogged = false;
 
 	while (!vvbWindow.shouldClose())
 	{
@@ -84,6 +85,14 @@ void App::run()
 
 		processInput(vvbWindow.getGLFWWindow());
 
+		// cycle through the chunk meshers
+		if (mesherKey && !prevMesherKey)
+		{
+			int nextType = ((int)renderSystem.getMesherType() + 1) % (int)ChunkMesher::Type::NUM_TYPES;
+			renderSystem.setMesherType((ChunkMesher::Type)nextType);
+			std::cout << "chunk mesher : " << ChunkMesher::getTypeName(renderSystem.getMesherType()) << std::endl;
+		}
+
 		auto newTime = std::chrono::high_resolution_clock::now();
 
 		float time = std::chrono::duration<float, std::chrono::seconds::period>(currentTime - newTime).count();
@@ -111,7 +120,13 @@ void App::run()
 			ubo.view = camera.getView();
 			ubo.proj = camera.getProjection();
 			uboBuffers[frameIndex]->write(&ubo);
-			//renderSystem.update(cameraPos, cameraRot);
+			renderSystem.update(cameraPos, cameraRot);
+
+			if (renderSystem.isWorldLoaded() && !isWorldLoadLogged)
+			{
+				std::cout << "world loaded in " << renderSystem.getWorldLoadMilliseconds() << " ms" << std::endl;
+				isWorldLoadLogged = true;
+			}
 
 			// render
 			vvbRenderer.beginSwapChainRenderPass(commandBuffer);
@@ -147,5 +162,8 @@ void App::processInput(GLFWwindow* window)
 	{
 		objectsRotation = !objectsRotation;
 	}
+
+	prevMesherKey = mesherKey;
+	mesherKey = (glfwGetKey(window, GLFW_KEY_M) == GLFW_PRESS);
 }
 
@@ -0,0 +1,203 @@
+// vulkan base
+#include "job/task_scheduler.hpp"
+
+// std
+#include <algorithm>
+
+thread_local const TaskScheduler* TaskScheduler::currentScheduler = nullptr;
+thread_local uint32_t TaskScheduler::currentQueueIndex = 0;
+
+TaskScheduler::TaskScheduler(uint32_t threadCount)
+{
+	if (threadCount == 0)
+		threadCount = std::max(2u, std::thread::hardware_concurrency()) - 1;
+
+	// one deque per worker, then the one shared by the other threads and the one of the background tasks
+	for (uint32_t i = 0; i < threadCount + 2; i++)
+		queues.push_back(std::make_unique<TaskQueue>());
+
+	threads.reserve(threadCount);
+	for (uint32_t i = 0; i < threadCount; i++)
+		threads.emplace_back(&TaskScheduler::workerLoop, this, i);
+}
+
+TaskScheduler::~TaskScheduler()
+{
+	waitAll();
+
+	{
+		std::lock_guard<std::mutex> lock(sleepMutex);
+		isStopping = true;
+	}
+	wakeUp.notify_all();
+
+	for (std::thread& thread : threads)
+		thread.join();
+}
+
+TaskScheduler::TaskHandle TaskScheduler::submit(std::function<void()> work, const std::vector<TaskHandle>& dependencies)
+{
+	TaskHandle task = std::make_shared<Task>();
+	task->work = std::move(work);
+	unfinishedCount++;
+
+	for (const TaskHandle& dependency : dependencies)
+	{
+		if (!dependency)
+			continue;
+
+		std::lock_guard<std::mutex> lock(dependency->mutex);
+		if (!dependency->isFinished)
+		{
+			task->pendingCount++;
+			dependency->dependents.push_back(task);
+		}
+	}
+
+	// drop the submission guard, otherwise the last dependency to finish schedules the task
+	if (task->pendingCount.fetch_sub(1) == 1)
+		schedule(task);
+
+	return task;
+}
+
+TaskScheduler::TaskHandle TaskScheduler::submitBackground(std::function<void()> work)
+{
+	TaskHandle task = std::make_shared<Task>();
+	task->work = std::move(work);
+	task->pendingCount = 0;
+	task->isBackground = true;
+	unfinishedCount++;
+
+	schedule(task);
+	return task;
+}
+
+void TaskScheduler::wait(const TaskHandle& task)
+{
+	uint32_t queueIndex = getQueueIndex();
+	while (!task->isFinished)
+	{
+		if (!runOneTask(queueIndex, false))
+			std::this_thread::yield();
+	}
+}
+
+void TaskScheduler::waitAll()
+{
+	uint32_t queueIndex = getQueueIndex();
+	while (unfinishedCount > 0)
+	{
+		if (!runOneTask(queueIndex, true))
+			std::this_thread::yield();
+	}
+}
+
+uint32_t TaskScheduler::getQueueIndex() const
+{
+	if (currentScheduler == this)
+		return currentQueueIndex;
+
+	return static_cast<uint32_t>(queues.size() - 2);
+}
+
+void TaskScheduler::schedule(TaskHandle task)
+{
+	TaskQueue& queue = *queues[task->isBackground ? getBackgroundQueueIndex() : getQueueIndex()];
+	{
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		queue.tasks.push_back(std::move(task));
+
+		// counted under the queue lock so that the pop of this task can't be counted first
+		queuedCount++;
+	}
+
+	// a worker going to sleep checks queuedCount after raising sleepingCount, one of the two sides sees the other
+	if (sleepingCount > 0)
+	{
+		{
+			std::lock_guard<std::mutex> lock(sleepMutex);
+		}
+		wakeUp.notify_one();
+	}
+}
+
+bool TaskScheduler::runOneTask(uint32_t queueIndex, bool runsBackground)
+{
+	TaskHandle task;
+
+	// newest task of our own deque first, it is the most likely to be in cache
+	{
+		TaskQueue& queue = *queues[queueIndex];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if (!queue.tasks.empty())
+		{
+			task = std::move(queue.tasks.back());
+			queue.tasks.pop_back();
+		}
+	}
+
+	// then steal the oldest task of the other deques
+	for (uint32_t i = 1; !task && i < queues.size(); i++)
+	{
+		uint32_t otherIndex = (queueIndex + i) % static_cast<uint32_t>(queues.size());
+		if (otherIndex == getBackgroundQueueIndex() && !runsBackground)
+			continue;
+
+		TaskQueue& queue = *queues[otherIndex];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if (!queue.tasks.empty())
+		{
+			task = std::move(queue.tasks.front());
+			queue.tasks.pop_front();
+		}
+	}
+
+	if (!task)
+		return false;
+
+	queuedCount--;
+	task->work();
+	finish(task);
+	return true;
+}
+
+void TaskScheduler::finish(const TaskHandle& task)
+{
+	std::vector<TaskHandle> dependents;
+	{
+		std::lock_guard<std::mutex> lock(task->mutex);
+		task->isFinished = true;
+		dependents.swap(task->dependents);
+	}
+
+	for (TaskHandle& dependent : dependents)
+	{
+		if (dependent->pendingCount.fetch_sub(1) == 1)
+			schedule(std::move(dependent));
+	}
+
+	// release what the work captured, handles may live much longer than the task
+	task->work = nullptr;
+	unfinishedCount--;
+}
+
+void TaskScheduler::workerLoop(uint32_t queueIndex)
+{
+	currentScheduler = this;
+	currentQueueIndex = queueIndex;
+
+	while (true)
+	{
+		if (runOneTask(queueIndex, true))
+			continue;
+
+		std::unique_lock<std::mutex> lock(sleepMutex);
+		sleepingCount++;
+		wakeUp.wait(lock, [this]() { return isStopping || queuedCount > 0; });
+		sleepingCount--;
+
+		if (isStopping && queuedCount == 0)
+			return;
+	}
+}
@@ -0,0 +1,263 @@
+// vulkan base
+#include "memory/tlsf_allocator.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+TlsfAllocator::TlsfAllocator(uint64_t size)
+	: size(size & ~(Granularity - 1))
+{
+	for (std::array<uint32_t, SecondLevelCount>& lists : freeLists)
+		lists.fill(NullBlock);
+
+	if (this->size > 0)
+		insertFree(createBlock(0, this->size));
+}
+
+bool TlsfAllocator::allocate(uint64_t requestedSize, uint64_t alignment, Allocation& allocation)
+{
+	assert(alignment > 0 && (alignment & (alignment - 1)) == 0 && "alignment must be a power of two");
+
+	uint64_t allocationSize = (std::max<uint64_t>(requestedSize, 1) + Granularity - 1) & ~(Granularity - 1);
+	alignment = std::max(alignment, Granularity);
+
+	// a range this large fits the allocation wherever it starts
+	uint64_t searchSize = allocationSize + alignment - Granularity;
+	if (searchSize > getFreeSize())
+		return false;
+
+	// round up to the next list : every range of that list and above is large enough, no list has to be walked
+	uint64_t roundedSize = searchSize;
+	if (searchSize >= SecondLevelCount)
+		roundedSize += (1ull << (floorLog2(searchSize) - SecondLevelLog2)) - 1;
+
+	uint32_t firstLevel, secondLevel;
+	getListIndex(roundedSize, firstLevel, secondLevel);
+	if (firstLevel >= FirstLevelCount)
+		return false;
+
+	uint32_t secondLevelBitmap = secondLevelBitmaps[firstLevel] & (~0u << secondLevel);
+	if (secondLevelBitmap == 0)
+	{
+		uint64_t firstLevelBitmap = firstLevel + 1 < 64 ? this->firstLevelBitmap & (~0ull << (firstLevel + 1)) : 0;
+		if (firstLevelBitmap == 0)
+			return false;
+
+		firstLevel = countTrailingZeros(firstLevelBitmap);
+		secondLevelBitmap = secondLevelBitmaps[firstLevel];
+	}
+	secondLevel = countTrailingZeros(secondLevelBitmap);
+
+	uint32_t block = freeLists[firstLevel][secondLevel];
+	assert(block != NullBlock && blocks[block].size >= searchSize && "tlsf lists out of sync with their bitmaps");
+	removeFree(block);
+
+	// the space before the aligned offset and the one after the allocation go back to the free lists
+	uint64_t alignedOffset = (blocks[block].offset + alignment - 1) & ~(alignment - 1);
+	if (alignedOffset > blocks[block].offset)
+	{
+		uint32_t front = block;
+		block = split(front, alignedOffset);
+		insertFree(front);
+	}
+
+	if (blocks[block].size > allocationSize)
+		insertFree(split(block, blocks[block].offset + allocationSize));
+
+	usedSize += blocks[block].size;
+	allocationCount++;
+
+	allocation.offset = blocks[block].offset;
+	allocation.size = blocks[block].size;
+	allocation.block = block;
+	return true;
+}
+
+void TlsfAllocator::free(Allocation& allocation)
+{
+	if (!allocation.isValid())
+		return;
+
+	uint32_t block = allocation.block;
+	assert(!blocks[block].isFree && blocks[block].offset == allocation.offset && "allocation freed twice or from another allocator");
+
+	usedSize -= blocks[block].size;
+	allocationCount--;
+
+	// free neighbours are merged at once, two free ranges are never next to each other
+	uint32_t next = blocks[block].nextPhysical;
+	if (next != NullBlock && blocks[next].isFree)
+	{
+		removeFree(next);
+		absorbNext(block);
+	}
+
+	uint32_t previous = blocks[block].previousPhysical;
+	if (previous != NullBlock && blocks[previous].isFree)
+	{
+		removeFree(previous);
+		absorbNext(previous);
+		block = previous;
+	}
+
+	insertFree(block);
+	allocation = Allocation();
+}
+
+uint64_t TlsfAllocator::getLargestFreeRange() const
+{
+	if (firstLevelBitmap == 0)
+		return 0;
+
+	// the largest range is in the last non empty list, its ranges are not sorted
+	uint32_t firstLevel = static_cast<uint32_t>(floorLog2(firstLevelBitmap));
+	uint32_t secondLevel = static_cast<uint32_t>(floorLog2(secondLevelBitmaps[firstLevel]));
+
+	uint64_t largest = 0;
+	for (uint32_t block = freeLists[firstLevel][secondLevel]; block != NullBlock; block = blocks[block].nextFree)
+		largest = std::max(largest, blocks[block].size);
+	return largest;
+}
+
+uint32_t TlsfAllocator::createBlock(uint64_t offset, uint64_t blockSize)
+{
+	uint32_t block;
+	if (unusedBlocks.empty())
+	{
+		block = static_cast<uint32_t>(blocks.size());
+		blocks.emplace_back();
+	}
+	else
+	{
+		block = unusedBlocks.back();
+		unusedBlocks.pop_back();
+		blocks[block] = Block();
+	}
+
+	blocks[block].offset = offset;
+	blocks[block].size = blockSize;
+	return block;
+}
+
+void TlsfAllocator::destroyBlock(uint32_t block)
+{
+	unusedBlocks.push_back(block);
+}
+
+void TlsfAllocator::insertFree(uint32_t block)
+{
+	uint32_t firstLevel, secondLevel;
+	getListIndex(blocks[block].size, firstLevel, secondLevel);
+
+	uint32_t head = freeLists[firstLevel][secondLevel];
+	blocks[block].isFree = true;
+	blocks[block].previousFree = NullBlock;
+	blocks[block].nextFree = head;
+	if (head != NullBlock)
+		blocks[head].previousFree = block;
+
+	freeLists[firstLevel][secondLevel] = block;
+	firstLevelBitmap |= 1ull << firstLevel;
+	secondLevelBitmaps[firstLevel] |= 1u << secondLevel;
+	freeRangeCount++;
+}
+
+void TlsfAllocator::removeFree(uint32_t block)
+{
+	Block& removed = blocks[block];
+	if (removed.previousFree != NullBlock)
+		blocks[removed.previousFree].nextFree = removed.nextFree;
+	if (removed.nextFree != NullBlock)
+		blocks[removed.nextFree].previousFree = removed.previousFree;
+
+	uint32_t firstLevel, secondLevel;
+	getListIndex(removed.size, firstLevel, secondLevel);
+	if (freeLists[firstLevel][secondLevel] == block)
+	{
+		freeLists[firstLevel][secondLevel] = removed.nextFree;
+		if (removed.nextFree == NullBlock)
+		{
+			secondLevelBitmaps[firstLevel] &= ~(1u << secondLevel);
+			if (secondLevelBitmaps[firstLevel] == 0)
+				firstLevelBitmap &= ~(1ull << firstLevel);
+		}
+	}
+
+	removed.isFree = false;
+	removed.previousFree = NullBlock;
+	removed.nextFree = NullBlock;
+	freeRangeCount--;
+}
+
+uint32_t TlsfAllocator::split(uint32_t block, uint64_t offset)
+{
+	assert(offset > blocks[block].offset && offset < blocks[block].offset + blocks[block].size && "split outside of the block");
+
+	uint32_t tail = createBlock(offset, blocks[block].offset + blocks[block].size - offset);
+	blocks[block].size = offset - blocks[block].offset;
+
+	blocks[tail].previousPhysical = block;
+	blocks[tail].nextPhysical = blocks[block].nextPhysical;
+	if (blocks[tail].nextPhysical != NullBlock)
+		blocks[blocks[tail].nextPhysical].previousPhysical = tail;
+	blocks[block].nextPhysical = tail;
+	return tail;
+}
+
+void TlsfAllocator::absorbNext(uint32_t block)
+{
+	uint32_t next = blocks[block].nextPhysical;
+	blocks[block].size += blocks[next].size;
+	blocks[block].nextPhysical = blocks[next].nextPhysical;
+	if (blocks[block].nextPhysical != NullBlock)
+		blocks[blocks[block].nextPhysical].previousPhysical = block;
+	destroyBlock(next);
+}
+
+// sizes below SecondLevelCount share the first level 0, one list each,
+// above every power of two is its own first level cut in SecondLevelCount lists
+void TlsfAllocator::getListIndex(uint64_t blockSize, uint32_t& firstLevel, uint32_t& secondLevel)
+{
+	if (blockSize < SecondLevelCount)
+	{
+		firstLevel = 0;
+		secondLevel = static_cast<uint32_t>(blockSize);
+		return;
+	}
+
+	int log2 = floorLog2(blockSize);
+	firstLevel = static_cast<uint32_t>(log2) - SecondLevelLog2 + 1;
+	secondLevel = static_cast<uint32_t>(blockSize >> (log2 - SecondLevelLog2)) - SecondLevelCount;
+}
+
+int TlsfAllocator::countTrailingZeros(uint64_t bits)
+{
+	if (bits == 0)
+		return 64;
+
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanForward64(&index, bits);
+	return static_cast<int>(index);
+#else
+	return __builtin_ctzll(bits);
+#endif
+}
+
+int TlsfAllocator::floorLog2(uint64_t value)
+{
+	assert(value != 0 && "log2 of 0");
+
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanReverse64(&index, value);
+	return static_cast<int>(index);
+#else
+	return 63 - __builtin_clzll(value);
+#endif
+}
@@ -0,0 +1,67 @@
+// vulkan base
+#include "mesher/async_chunk_mesher.hpp"
+
+// std
+#include <memory>
+
+AsyncChunkMesher::AsyncChunkMesher(TaskScheduler& taskScheduler)
+	: taskScheduler(taskScheduler)
+{
+}
+
+AsyncChunkMesher::~AsyncChunkMesher()
+{
+	wait();
+}
+
+void AsyncChunkMesher::submit(ChunkMesher::Type type, const World& world, glm::ivec3 chunkCoord, VertexFormat vertexFormat, uint64_t sectionMask)
+{
+	// the world keeps changing on the main thread, the job only sees this copy
+	std::shared_ptr<ChunkSnapshot> snapshot(snapshotPool.acquire().release(), [this](ChunkSnapshot* used) {
+		snapshotPool.release(std::unique_ptr<ChunkSnapshot>(used));
+	});
+	glm::ivec3 min, max;
+	Chunk::getSectionBounds(sectionMask, min, max);
+	snapshot->capture(world, chunkCoord, min, max);
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		pendingCount++;
+	}
+
+	// the render thread waiting on a world stage must not end up meshing
+	taskScheduler.submitBackground([this, snapshot, type, vertexFormat, sectionMask]() mutable {
+		Result result{ snapshot->coord, snapshot->revision, {} };
+		result.meshData.vertexFormat = vertexFormat;
+		if (sectionMask == 0)
+			ChunkMesher::generate(type, *snapshot, result.meshData);
+		else
+			ChunkMesher::generateSections(type, *snapshot, sectionMask, result.meshData);
+
+		// back to the pool before the result is published, so the snapshot is free once the job is seen as done
+		snapshot.reset();
+
+		std::lock_guard<std::mutex> lock(mutex);
+		results.push_back(std::move(result));
+		pendingCount--;
+	});
+}
+
+void AsyncChunkMesher::collect(std::vector<Result>& finished)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	for (Result& result : results)
+		finished.push_back(std::move(result));
+	results.clear();
+}
+
+void AsyncChunkMesher::wait()
+{
+	taskScheduler.waitAll();
+}
+
+uint32_t AsyncChunkMesher::getPendingCount() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return pendingCount;
+}
@@ -0,0 +1,374 @@
+// vulkan base
+#include "mesher/chunk_mesher.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// one bit per voxel of a column
+static_assert(Chunk::ChunkSize <= 64, "binary mesher columns are 64 bit wide");
+
+void ChunkMeshData::clear()
+{
+	vertices.clear();
+	packedVertices.clear();
+	sectionVertexCounts.fill(0);
+	sectionMask = 0;
+}
+
+// corners are listed in the winding order of the original cube mesh
+const std::array<ChunkMesher::FaceDescription, (size_t)ChunkMesher::Face::NUM_FACES> ChunkMesher::faces = { {
+	// front
+	{ {  0,  0,  1 }, { glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(1.0f, 0.0f, 1.0f), glm::vec3(1.0f, 1.0f, 1.0f), glm::vec3(0.0f, 1.0f, 1.0f) } },
+	// back
+	{ {  0,  0, -1 }, { glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(1.0f, 1.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f) } },
+	// left
+	{ { -1,  0,  0 }, { glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, 1.0f, 1.0f), glm::vec3(0.0f, 1.0f, 0.0f) } },
+	// right
+	{ {  1,  0,  0 }, { glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(1.0f, 0.0f, 1.0f), glm::vec3(1.0f, 1.0f, 1.0f), glm::vec3(1.0f, 1.0f, 0.0f) } },
+	// top
+	{ {  0,  1,  0 }, { glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(1.0f, 1.0f, 0.0f), glm::vec3(1.0f, 1.0f, 1.0f), glm::vec3(0.0f, 1.0f, 1.0f) } },
+	// bottom
+	{ {  0, -1,  0 }, { glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(1.0f, 0.0f, 1.0f), glm::vec3(0.0f, 0.0f, 1.0f) } },
+} };
+
+void ChunkMesher::generate(Type type, const ChunkSnapshot& snapshot, ChunkMeshData& mesh, glm::ivec3 origin, int size)
+{
+	assert(origin.x >= 0 && origin.y >= 0 && origin.z >= 0 && origin.x + size <= Chunk::ChunkSize && origin.y + size <= Chunk::ChunkSize && origin.z + size <= Chunk::ChunkSize && "mesher region out of the chunk");
+
+	// uniform chunks of air, and uniform solid chunks buried in solid voxels, come with an empty snapshot
+	if (snapshot.empty())
+		return;
+
+	switch (type)
+	{
+	case Type::naive:
+		generateNaive(snapshot, mesh, origin, size);
+		break;
+	case Type::culled:
+		generateCulled(snapshot, mesh, origin, size);
+		break;
+	case Type::greedy:
+		generateGreedy(snapshot, mesh, origin, size);
+		break;
+	case Type::binary:
+		generateBinary(snapshot, mesh, origin, size);
+		break;
+	default:
+		throw std::runtime_error("unknown chunk mesher type!");
+	}
+}
+
+void ChunkMesher::generate(Type type, const World& world, glm::ivec3 chunkCoord, ChunkMeshData& mesh)
+{
+	// reused between calls, one per meshing thread
+	thread_local ChunkSnapshot snapshot;
+	snapshot.capture(world, chunkCoord);
+	generate(type, snapshot, mesh);
+}
+
+void ChunkMesher::generateSections(Type type, const ChunkSnapshot& snapshot, uint64_t sectionMask, ChunkMeshData& mesh)
+{
+	mesh.sectionMask = sectionMask;
+	for (int section = 0; section < Chunk::SectionCount; section++)
+	{
+		if ((sectionMask & (1ull << section)) == 0)
+			continue;
+
+		uint32_t firstVertex = mesh.getVertexCount();
+		generate(type, snapshot, mesh, Chunk::getSectionOrigin(section), Chunk::SectionSize);
+		mesh.sectionVertexCounts[section] = mesh.getVertexCount() - firstVertex;
+	}
+}
+
+const char* ChunkMesher::getTypeName(Type type)
+{
+	switch (type)
+	{
+	case Type::naive: return "naive";
+	case Type::culled: return "culled";
+	case Type::greedy: return "greedy";
+	case Type::binary: return "binary";
+	default: return "unknown";
+	}
+}
+
+glm::ivec3 ChunkMesher::getFaceNormal(Face face)
+{
+	return faces[(size_t)face].normal;
+}
+
+void ChunkMesher::addFace(Face face, glm::vec3 position, uint16_t voxelId, ChunkMeshData& mesh, glm::vec3 size)
+{
+	const FaceDescription& description = faces[(size_t)face];
+
+	if (mesh.vertexFormat == VertexFormat::Packed)
+	{
+		// ambient occlusion is not computed yet, every corner is fully lit
+		for (const glm::vec3& corner : description.corners)
+			mesh.packedVertices.push_back(PackedVertex::pack(glm::ivec3(position + corner * size), (uint32_t)face, 0, voxelId));
+	}
+	else
+	{
+		glm::vec3 color = glm::vec3(1.0f, 1.0f, 1.0f);
+		glm::vec2 texCoord = glm::vec2(0.0f, 0.0f);
+
+		for (const glm::vec3& corner : description.corners)
+			mesh.vertices.push_back({ position + corner * size, color, texCoord });
+	}
+}
+
+void ChunkMesher::generateNaive(const ChunkSnapshot& snapshot, ChunkMeshData& mesh, glm::ivec3 origin, int size)
+{
+	for (int z = origin.z; z < origin.z + size; z++)
+	{
+		for (int y = origin.y; y < origin.y + size; y++)
+		{
+			for (int x = origin.x; x < origin.x + size; x++)
+			{
+				Voxel voxel = snapshot.getVoxel(x, y, z);
+				if (!voxel.isSolid())
+					continue;
+
+				for (int face = 0; face < (int)Face::NUM_FACES; face++)
+					addFace((Face)face, glm::vec3(x, y, z), voxel.id, mesh);
+			}
+		}
+	}
+}
+
+void ChunkMesher::generateCulled(const ChunkSnapshot& snapshot, ChunkMeshData& mesh, glm::ivec3 origin, int size)
+{
+	for (int z = origin.z; z < origin.z + size; z++)
+	{
+		for (int y = origin.y; y < origin.y + size; y++)
+		{
+			for (int x = origin.x; x < origin.x + size; x++)
+			{
+				Voxel voxel = snapshot.getVoxel(x, y, z);
+				if (!voxel.isSolid())
+					continue;
+
+				// the padding holds the neighbour chunks, border voxels need no special case
+				for (int face = 0; face < (int)Face::NUM_FACES; face++)
+				{
+					glm::ivec3 neighbour = glm::ivec3(x, y, z) + faces[face].normal;
+
+					if (!snapshot.getVoxel(neighbour.x, neighbour.y, neighbour.z).isSolid())
+						addFace((Face)face, glm::vec3(x, y, z), voxel.id, mesh);
+				}
+			}
+		}
+	}
+}
+
+// sweep each face direction slice by slice : build a mask of the visible faces keyed by voxel type
+// then grow every unvisited face along u first, then along v, as long as the type matches
+void ChunkMesher::generateGreedy(const ChunkSnapshot& snapshot, ChunkMeshData& mesh, glm::ivec3 origin, int size)
+{
+	// 0 means no face, voxel ids otherwise (air is never visible)
+	std::vector<uint16_t> mask(size * size);
+
+	for (int face = 0; face < (int)Face::NUM_FACES; face++)
+	{
+		glm::ivec3 normal = faces[face].normal;
+		int axis = normal.x != 0 ? 0 : (normal.y != 0 ? 1 : 2);
+		int u = (axis + 1) % 3;
+		int v = (axis + 2) % 3;
+
+		for (int depth = 0; depth < size; depth++)
+		{
+			// i, j and depth are relative to the origin of the region
+			glm::ivec3 position;
+			position[axis] = origin[axis] + depth;
+
+			for (int j = 0; j < size; j++)
+			{
+				for (int i = 0; i < size; i++)
+				{
+					position[u] = origin[u] + i;
+					position[v] = origin[v] + j;
+
+					glm::ivec3 neighbour = position + normal;
+					Voxel voxel = snapshot.getVoxel(position.x, position.y, position.z);
+					bool visible = voxel.isSolid() && !snapshot.getVoxel(neighbour.x, neighbour.y, neighbour.z).isSolid();
+					mask[i + j * size] = visible ? voxel.id : 0;
+				}
+			}
+
+			for (int j = 0; j < size; j++)
+			{
+				for (int i = 0; i < size;)
+				{
+					uint16_t type = mask[i + j * size];
+					if (type == 0)
+					{
+						i++;
+						continue;
+					}
+
+					int width = 1;
+					while (i + width < size && mask[i + width + j * size] == type)
+						width++;
+
+					int height = 1;
+					for (; j + height < size; height++)
+					{
+						bool rowMatches = true;
+						for (int k = 0; k < width && rowMatches; k++)
+							rowMatches = mask[i + k + (j + height) * size] == type;
+
+						if (!rowMatches)
+							break;
+					}
+
+					for (int h = 0; h < height; h++)
+						std::fill_n(mask.begin() + i + (j + h) * size, width, 0);
+
+					position[u] = origin[u] + i;
+					position[v] = origin[v] + j;
+
+					glm::vec3 quadSize(1.0f);
+					quadSize[u] = static_cast<float>(width);
+					quadSize[v] = static_cast<float>(height);
+
+					addFace((Face)face, glm::vec3(position), type, mesh, quadSize);
+
+					i += width;
+				}
+			}
+		}
+	}
+}
+
+// columns run along one axis and are indexed by their (u, v) position on the other two axes,
+// the neighbour voxels past both ends of a column come from the snapshot padding so border faces are culled like the others
+void ChunkMesher::generateBinary(const ChunkSnapshot& snapshot, ChunkMeshData& mesh, glm::ivec3 origin, int size)
+{
+	// reused between calls, one set per meshing thread
+	thread_local std::vector<uint64_t> columns[3];
+	thread_local std::vector<uint64_t> planes;
+
+	for (int axis = 0; axis < 3; axis++)
+		columns[axis].assign(size * size, 0);
+
+	// fill the occupancy columns of the three axes in one pass over the region, in region coordinates
+	for (int z = 0; z < size; z++)
+	{
+		for (int y = 0; y < size; y++)
+		{
+			for (int x = 0; x < size; x++)
+			{
+				uint64_t solid = snapshot.getVoxel(origin.x + x, origin.y + y, origin.z + z).isSolid() ? 1 : 0;
+				columns[0][y + z * size] |= solid << x;
+				columns[1][z + x * size] |= solid << y;
+				columns[2][x + y * size] |= solid << z;
+			}
+		}
+	}
+
+	// planes[(type * size + depth) * size + v] holds the visible faces of a slice as u bits
+	const int typeCount = (int)Voxel::Type::NUM_TYPES;
+
+	for (int face = 0; face < (int)Face::NUM_FACES; face++)
+	{
+		glm::ivec3 normal = faces[face].normal;
+		int axis = normal.x != 0 ? 0 : (normal.y != 0 ? 1 : 2);
+		int u = (axis + 1) % 3;
+		int v = (axis + 2) % 3;
+		bool positive = normal[axis] > 0;
+
+		planes.assign(typeCount * size * size, 0);
+
+		for (int j = 0; j < size; j++)
+		{
+			for (int i = 0; i < size; i++)
+			{
+				uint64_t column = columns[axis][i + j * size];
+
+				// a face is visible where a solid bit is followed by an empty one in the face direction,
+				// past the end of the column that is the neighbour voxel, in the next region or the snapshot padding
+				glm::ivec3 outsidePosition;
+				outsidePosition[axis] = origin[axis] + (positive ? size : -1);
+				outsidePosition[u] = origin[u] + i;
+				outsidePosition[v] = origin[v] + j;
+				uint64_t outside = snapshot.getVoxel(outsidePosition.x, outsidePosition.y, outsidePosition.z).isSolid() ? 1 : 0;
+				uint64_t ahead = positive ? (column >> 1) | (outside << (size - 1)) : (column << 1) | outside;
+				uint64_t visible = column & ~ahead;
+
+				while (visible)
+				{
+					int depth = countTrailingZeros(visible);
+					visible &= visible - 1;
+
+					glm::ivec3 position;
+					position[axis] = origin[axis] + depth;
+					position[u] = origin[u] + i;
+					position[v] = origin[v] + j;
+
+					uint16_t type = snapshot.getVoxel(position.x, position.y, position.z).id;
+					assert(type < typeCount && "voxel id out of the voxel types range");
+
+					planes[(type * size + depth) * size + j] |= 1ull << i;
+				}
+			}
+		}
+
+		// merge each plane : take the first run of bits of a row then eat the rows above with the same run
+		for (int plane = 0; plane < typeCount * size; plane++)
+		{
+			uint64_t* rows = &planes[plane * size];
+			uint16_t type = static_cast<uint16_t>(plane / size);
+			int depth = plane % size;
+
+			for (int j = 0; j < size; j++)
+			{
+				while (rows[j])
+				{
+					int i = countTrailingZeros(rows[j]);
+					int width = countTrailingZeros(~(rows[j] >> i));
+					uint64_t run = (width == 64 ? ~0ull : (1ull << width) - 1) << i;
+
+					rows[j] &= ~run;
+
+					int height = 1;
+					while (j + height < size && (rows[j + height] & run) == run)
+					{
+						rows[j + height] &= ~run;
+						height++;
+					}
+
+					glm::ivec3 position;
+					position[axis] = origin[axis] + depth;
+					position[u] = origin[u] + i;
+					position[v] = origin[v] + j;
+
+					glm::vec3 quadSize(1.0f);
+					quadSize[u] = static_cast<float>(width);
+					quadSize[v] = static_cast<float>(height);
+
+					addFace((Face)face, glm::vec3(position), type, mesh, quadSize);
+				}
+			}
+		}
+	}
+}
+
+int ChunkMesher::countTrailingZeros(uint64_t bits)
+{
+	if (bits == 0)
+		return 64;
+
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanForward64(&index, bits);
+	return static_cast<int>(index);
+#else
+	return __builtin_ctzll(bits);
+#endif
+}
@@ -0,0 +1,185 @@
+// vulkan base
+#include "mesher/chunk_snapshot.hpp"
+
+// std
+#include <algorithm>
+
+// every voxel of the slice of chunk touching its neighbour on that side is solid
+static bool isSliceSolid(const Chunk& chunk, int axis, bool positive)
+{
+	if (chunk.voxels.isUniform())
+		return chunk.voxels.get(0).isSolid();
+
+	int u = (axis + 1) % 3;
+	int v = (axis + 2) % 3;
+
+	glm::ivec3 position;
+	position[axis] = positive ? Chunk::ChunkSize - 1 : 0;
+	for (int j = 0; j < Chunk::ChunkSize; j++)
+	{
+		for (int i = 0; i < Chunk::ChunkSize; i++)
+		{
+			position[u] = i;
+			position[v] = j;
+			if (!chunk.getVoxel(position.x, position.y, position.z).isSolid())
+				return false;
+		}
+	}
+	return true;
+}
+
+ChunkSnapshot::ChunkSnapshot(const World& world, glm::ivec3 chunkCoord)
+{
+	capture(world, chunkCoord);
+}
+
+void ChunkSnapshot::capture(const World& world, glm::ivec3 chunkCoord)
+{
+	capture(world, chunkCoord, glm::ivec3(0), glm::ivec3(Chunk::ChunkSize));
+}
+
+void ChunkSnapshot::capture(const World& world, glm::ivec3 chunkCoord, glm::ivec3 min, glm::ivec3 max)
+{
+	const int size = Chunk::ChunkSize;
+
+	coord = chunkCoord;
+	isEmpty = true;
+
+	// a chunk that is not loaded yet has no voxels to read
+	const Chunk* chunk = world.getChunk(chunkCoord);
+	if (chunk == nullptr || !chunk->isLoaded)
+	{
+		revision = 0;
+		return;
+	}
+
+	revision = chunk->revision;
+
+	// a uniform chunk of air has no face to show, whatever its neighbours
+	bool isUniform = chunk->voxels.isUniform();
+	if (isUniform && !chunk->voxels.get(0).isSolid())
+		return;
+
+	// a uniform solid chunk walled in by solid voxels on every side has no face to show either
+	if (isUniform)
+	{
+		bool isEnclosed = true;
+		for (int axis = 0; axis < 3 && isEnclosed; axis++)
+		{
+			for (bool positive : { false, true })
+			{
+				glm::ivec3 offset(0);
+				offset[axis] = positive ? 1 : -1;
+				const Chunk* neighbour = world.getChunk(chunkCoord + offset);
+				if (neighbour == nullptr || !neighbour->isLoaded || !isSliceSolid(*neighbour, axis, !positive))
+				{
+					isEnclosed = false;
+					break;
+				}
+			}
+		}
+
+		if (isEnclosed)
+			return;
+	}
+
+	// the size is kept between captures, a recycled snapshot neither allocates nor clears
+	// every cell of the box is written below, from the chunks or as air
+	voxels.resize(PaddedSize * PaddedSize * PaddedSize);
+	isEmpty = false;
+
+	// the box and the voxels around it, in the chunk and its 26 neighbours : a whole chunk only needs a slice,
+	// a row or a single voxel of each neighbour, a section only the few chunks it touches
+	glm::ivec3 boxMin = min - glm::ivec3(1);
+	glm::ivec3 boxMax = max + glm::ivec3(1);
+	for (int z = -1; z <= 1; z++)
+	{
+		for (int y = -1; y <= 1; y++)
+		{
+			for (int x = -1; x <= 1; x++)
+			{
+				glm::ivec3 offset(x, y, z);
+
+				// the part of the box in that chunk, in its local coordinates
+				glm::ivec3 localMin = glm::max(boxMin - offset * size, glm::ivec3(0));
+				glm::ivec3 localMax = glm::min(boxMax - offset * size, glm::ivec3(size));
+				if (localMin.x >= localMax.x || localMin.y >= localMax.y || localMin.z >= localMax.z)
+					continue;
+
+				const Chunk* source = offset == glm::ivec3(0) ? chunk : world.getChunk(chunkCoord + offset);
+				if (source == nullptr || !source->isLoaded)
+					fillRegion(Voxel((uint16_t)Voxel::Type::air), offset, localMin, localMax);
+				else if (source->voxels.isUniform())
+					fillRegion(source->voxels.get(0), offset, localMin, localMax);
+				else
+					copyRegion(*source, offset, localMin, localMax);
+			}
+		}
+	}
+}
+
+void ChunkSnapshot::copyRegion(const Chunk& chunk, glm::ivec3 offset, glm::ivec3 min, glm::ivec3 max)
+{
+	const int size = Chunk::ChunkSize;
+	glm::ivec3 shift = offset * size;
+
+	// a whole chunk is decoded in one go, much cheaper than a get per voxel
+	if (min == glm::ivec3(0) && max == glm::ivec3(size))
+	{
+		thread_local std::vector<Voxel> decoded;
+		decoded.resize(chunk.voxels.getVoxelCount());
+		chunk.voxels.decode(decoded.data());
+
+		for (int z = 0; z < size; z++)
+		{
+			for (int y = 0; y < size; y++)
+			{
+				Voxel* row = &voxels[getPaddedIndex(shift.x, y + shift.y, z + shift.z)];
+				for (int x = 0; x < size; x++)
+					row[x] = decoded[Chunk::getVoxelIndex(x, y, z)];
+			}
+		}
+		return;
+	}
+
+	for (int z = min.z; z < max.z; z++)
+		for (int y = min.y; y < max.y; y++)
+			for (int x = min.x; x < max.x; x++)
+				voxels[getPaddedIndex(x + shift.x, y + shift.y, z + shift.z)] = chunk.getVoxel(x, y, z);
+}
+
+void ChunkSnapshot::fillRegion(Voxel voxel, glm::ivec3 offset, glm::ivec3 min, glm::ivec3 max)
+{
+	glm::ivec3 shift = offset * Chunk::ChunkSize;
+
+	for (int z = min.z; z < max.z; z++)
+	{
+		for (int y = min.y; y < max.y; y++)
+		{
+			Voxel* row = &voxels[getPaddedIndex(min.x + shift.x, y + shift.y, z + shift.z)];
+			std::fill(row, row + (max.x - min.x), voxel);
+		}
+	}
+}
+
+std::unique_ptr<ChunkSnapshot> ChunkSnapshotPool::acquire()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (!freeSnapshots.empty())
+		{
+			std::unique_ptr<ChunkSnapshot> snapshot = std::move(freeSnapshots.back());
+			freeSnapshots.pop_back();
+			return snapshot;
+		}
+	}
+
+	createdCount++;
+	return std::make_unique<ChunkSnapshot>();
+}
+
+void ChunkSnapshotPool::release(std::unique_ptr<ChunkSnapshot> snapshot)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	freeSnapshots.push_back(std::move(snapshot));
+}
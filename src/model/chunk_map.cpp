@@ -0,0 +1,107 @@
+// vulkan base
+#include "model/chunk_map.hpp"
+
+// std
+#include <cassert>
+
+ChunkMap::ChunkMap(size_t capacity)
+{
+	size_t slotCount = 16;
+	while (slotCount < capacity * 2)
+		slotCount *= 2;
+
+	slots.assign(slotCount, { glm::ivec3(0), InvalidChunkHandle });
+}
+
+ChunkHandle ChunkMap::find(glm::ivec3 coord) const
+{
+	size_t mask = slots.size() - 1;
+	for (size_t index = getHomeSlot(coord);; index = (index + 1) & mask)
+	{
+		const Slot& slot = slots[index];
+		if (slot.handle == InvalidChunkHandle)
+			return InvalidChunkHandle;
+		if (slot.coord == coord)
+			return slot.handle;
+	}
+}
+
+void ChunkMap::insert(glm::ivec3 coord, ChunkHandle handle)
+{
+	assert(handle != InvalidChunkHandle && "can't insert an invalid chunk handle");
+	assert(find(coord) == InvalidChunkHandle && "chunk coordinate already in the map");
+
+	if ((count + 1) * 2 > slots.size())
+		grow();
+
+	size_t mask = slots.size() - 1;
+	size_t index = getHomeSlot(coord);
+	while (slots[index].handle != InvalidChunkHandle)
+		index = (index + 1) & mask;
+
+	slots[index] = { coord, handle };
+	count++;
+}
+
+bool ChunkMap::erase(glm::ivec3 coord)
+{
+	size_t mask = slots.size() - 1;
+	size_t hole = getHomeSlot(coord);
+	while (true)
+	{
+		if (slots[hole].handle == InvalidChunkHandle)
+			return false;
+		if (slots[hole].coord == coord)
+			break;
+		hole = (hole + 1) & mask;
+	}
+
+	// pull back the entries of the run that can't be reached anymore through the hole
+	for (size_t index = (hole + 1) & mask; slots[index].handle != InvalidChunkHandle; index = (index + 1) & mask)
+	{
+		// the entry can fill the hole if the hole lies between its home slot and where it is now
+		size_t home = getHomeSlot(slots[index].coord);
+		if (((index - home) & mask) >= ((index - hole) & mask))
+		{
+			slots[hole] = slots[index];
+			hole = index;
+		}
+	}
+
+	slots[hole].handle = InvalidChunkHandle;
+	count--;
+	return true;
+}
+
+void ChunkMap::clear()
+{
+	for (Slot& slot : slots)
+		slot.handle = InvalidChunkHandle;
+	count = 0;
+}
+
+size_t ChunkMap::getHomeSlot(glm::ivec3 coord) const
+{
+	// one multiply per axis then a final mix, neighbouring coordinates land far apart and negative ones are fine
+	uint64_t hash = static_cast<uint64_t>(static_cast<uint32_t>(coord.x)) * 0x9E3779B185EBCA87ull
+		^ static_cast<uint64_t>(static_cast<uint32_t>(coord.y)) * 0xC2B2AE3D27D4EB4Full
+		^ static_cast<uint64_t>(static_cast<uint32_t>(coord.z)) * 0x165667B19E3779F9ull;
+	hash ^= hash >> 32;
+	hash *= 0xD6E8FEB86659FD93ull;
+	hash ^= hash >> 32;
+
+	return static_cast<size_t>(hash) & (slots.size() - 1);
+}
+
+void ChunkMap::grow()
+{
+	std::vector<Slot> oldSlots(slots.size() * 2, { glm::ivec3(0), InvalidChunkHandle });
+	oldSlots.swap(slots);
+	count = 0;
+
+	for (const Slot& slot : oldSlots)
+	{
+		if (slot.handle != InvalidChunkHandle)
+			insert(slot.coord, slot.handle);
+	}
+}
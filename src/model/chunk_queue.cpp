@@ -0,0 +1,116 @@
+// vulkan base
+#include "model/chunk_queue.hpp"
+
+// std
+#include <cassert>
+#include <utility>
+
+void ChunkQueue::push(ChunkHandle chunk, float priority)
+{
+	if (chunk >= positions.size())
+		positions.resize(chunk + 1, NotQueued);
+
+	if (positions[chunk] != NotQueued)
+	{
+		size_t index = positions[chunk];
+		float oldPriority = heap[index].priority;
+		heap[index].priority = priority;
+
+		if (priority < oldPriority)
+			siftUp(index);
+		else
+			siftDown(index);
+		return;
+	}
+
+	heap.push_back({ priority, chunk });
+	positions[chunk] = static_cast<uint32_t>(heap.size() - 1);
+	siftUp(heap.size() - 1);
+}
+
+ChunkHandle ChunkQueue::pop()
+{
+	assert(!heap.empty() && "can't pop an empty chunk queue");
+
+	ChunkHandle chunk = heap.front().chunk;
+	remove(chunk);
+	return chunk;
+}
+
+void ChunkQueue::remove(ChunkHandle chunk)
+{
+	if (!contains(chunk))
+		return;
+
+	size_t index = positions[chunk];
+	size_t last = heap.size() - 1;
+
+	swapEntries(index, last);
+	heap.pop_back();
+	positions[chunk] = NotQueued;
+
+	// the entry moved into the hole may have to go either way
+	if (index < heap.size())
+	{
+		siftUp(index);
+		siftDown(index);
+	}
+}
+
+void ChunkQueue::reprioritize(const std::function<float(ChunkHandle)>& getPriority)
+{
+	for (Entry& entry : heap)
+		entry.priority = getPriority(entry.chunk);
+
+	// bottom up heapify, O(n)
+	for (size_t index = heap.size() / 2; index-- > 0;)
+		siftDown(index);
+}
+
+void ChunkQueue::clear()
+{
+	for (const Entry& entry : heap)
+		positions[entry.chunk] = NotQueued;
+	heap.clear();
+}
+
+void ChunkQueue::siftUp(size_t index)
+{
+	while (index > 0)
+	{
+		size_t parent = (index - 1) / 2;
+		if (heap[parent].priority <= heap[index].priority)
+			break;
+
+		swapEntries(index, parent);
+		index = parent;
+	}
+}
+
+void ChunkQueue::siftDown(size_t index)
+{
+	while (true)
+	{
+		size_t smallest = index;
+		size_t left = index * 2 + 1;
+		size_t right = left + 1;
+
+		if (left < heap.size() && heap[left].priority < heap[smallest].priority)
+			smallest = left;
+		if (right < heap.size() && heap[right].priority < heap[smallest].priority)
+			smallest = right;
+
+		if (smallest == index)
+			break;
+
+		swapEntries(index, smallest);
+		index = smallest;
+	}
+}
+
+void ChunkQueue::swapEntries(size_t a, size_t b)
+{
+	std::swap(heap[a], heap[b]);
+	positions[heap[a].chunk] = static_cast<uint32_t>(a);
+	positions[heap[b].chunk] = static_cast<uint32_t>(b);
+}
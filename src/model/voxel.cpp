@@ -1,4 +1,10 @@
 #include "model/voxel.hpp"
+#include "job/task_scheduler.hpp"
+#include "model/voxel_dag.hpp"
+
+// std
+#include <algorithm>
+#include <chrono>
 
 Voxel::Voxel(uint16_t id)
 	: id(id)
@@ -6,8 +12,8 @@ Voxel::Voxel(uint16_t id)
 }
 
 Chunk::Chunk()
+	: voxels(ChunkSize * ChunkSize * ChunkSize)
 {
-	voxels.resize(ChunkSize * ChunkSize * ChunkSize);
 }
 
 void Chunk::load()
@@ -18,38 +24,240 @@ void Chunk::load()
 void Chunk::setup()
 {
 	isSetup = true;
+	rebuild();
+	markAllDirty();
 }
 
+// the edits already marked their sections, compacting changes no voxel
 void Chunk::rebuild()
 {
+	// after compact the palette only holds the types in use
+	voxels.compact();
+	shouldRender = voxels.hasSolidType();
+}
 
+void Chunk::markBorderDirty(int axis, bool positive)
+{
+	int u = (axis + 1) % 3;
+	int v = (axis + 2) % 3;
+
+	glm::ivec3 position;
+	position[axis] = positive ? ChunkSize - 1 : 0;
+	for (int j = 0; j < ChunkSize; j += SectionSize)
+	{
+		for (int i = 0; i < ChunkSize; i += SectionSize)
+		{
+			position[u] = i;
+			position[v] = j;
+			dirtySections |= 1ull << getSectionIndex(position.x, position.y, position.z);
+		}
+	}
+	revision++;
 }
 
 void Chunk::unload()
 {
 	isLoaded = false;
+	isSetup = false;
+	shouldRender = false;
+}
+
+void Chunk::getSectionBounds(uint64_t sectionMask, glm::ivec3& min, glm::ivec3& max)
+{
+	if (sectionMask == 0)
+	{
+		min = glm::ivec3(0);
+		max = glm::ivec3(ChunkSize);
+		return;
+	}
+
+	min = glm::ivec3(ChunkSize);
+	max = glm::ivec3(0);
+	for (int section = 0; section < SectionCount; section++)
+	{
+		if ((sectionMask & (1ull << section)) == 0)
+			continue;
+
+		glm::ivec3 origin = getSectionOrigin(section);
+		min = glm::min(min, origin);
+		max = glm::max(max, origin + glm::ivec3(SectionSize));
+	}
 }
 
 World::World()
+	: _chunkGenerator(generateGround)
 {
-	chunks.resize(WorldSize * WorldSize * WorldSize);
+}
+
+const Chunk* World::getChunk(glm::ivec3 chunkCoord) const
+{
+	ChunkHandle handle = _chunkMap.find(chunkCoord);
+	if (handle == InvalidChunkHandle)
+		return nullptr;
+
+	return &chunks[handle];
+}
+
+Chunk* World::getChunk(glm::ivec3 chunkCoord)
+{
+	ChunkHandle handle = _chunkMap.find(chunkCoord);
+	if (handle == InvalidChunkHandle)
+		return nullptr;
+
+	return &chunks[handle];
+}
+
+ChunkHandle World::createChunk(glm::ivec3 chunkCoord)
+{
+	ChunkHandle handle = _chunkMap.find(chunkCoord);
+	if (handle != InvalidChunkHandle)
+		return handle;
+
+	if (_freeHandles.empty())
+	{
+		handle = static_cast<ChunkHandle>(chunks.size());
+		chunks.emplace_back();
+	}
+	else
+	{
+		handle = _freeHandles.back();
+		_freeHandles.pop_back();
+	}
+
+	// a recycled slot keeps its voxel storage, they are rewritten by the generator when the chunk loads
+	// the revision starts above the one of every chunk destroyed so far, whatever the slot, so that nothing
+	// meshed for a previous chunk at this coordinate passes for up to date
+	Chunk& chunk = chunks[handle];
+	chunk.coord = chunkCoord;
+	chunk.revision = _lastRevision;
+	chunk.markAllDirty();
+	chunk.firstRevision = chunk.revision;
+
+	_chunkMap.insert(chunkCoord, handle);
+	return handle;
+}
+
+void World::destroyChunk(ChunkHandle handle)
+{
+	Chunk& chunk = chunks[handle];
+	if (chunk.isLoaded)
+		chunk.unload();
+
+	_loadList.remove(handle);
+	_setupList.remove(handle);
+	_rebuildList.remove(handle);
+
+	_chunkMap.erase(chunk.coord);
+	_freeHandles.push_back(handle);
+	_lastRevision = std::max(_lastRevision, chunk.revision);
+
+	touchNeighbours(chunk.coord);
+	_forceVisibilityUpdate = true;
+}
+
+void World::touchNeighbours(glm::ivec3 chunkCoord)
+{
+	for (int axis = 0; axis < 3; axis++)
+	{
+		for (int direction : { -1, 1 })
+		{
+			glm::ivec3 offset(0);
+			offset[axis] = direction;
+			if (Chunk* neighbour = getChunk(chunkCoord + offset))
+				neighbour->markBorderDirty(axis, direction < 0);
+		}
+	}
+}
+
+void World::generateGround(Chunk& chunk)
+{
+	// height 0 is a chunk border : every chunk is uniform, all dirt or all air
+	chunk.voxels.fill(Voxel((uint16_t)(chunk.coord.y >= 0 ? Voxel::Type::dirt : Voxel::Type::air)));
+}
+
+glm::ivec3 World::splitWorldPosition(glm::ivec3 worldPosition, glm::ivec3& localPosition)
+{
+	// floor division so that negative positions land in the right chunk
+	glm::ivec3 chunkCoord;
+	for (int axis = 0; axis < 3; axis++)
+	{
+		chunkCoord[axis] = worldPosition[axis] >= 0
+			? worldPosition[axis] / Chunk::ChunkSize
+			: (worldPosition[axis] + 1) / Chunk::ChunkSize - 1;
+		localPosition[axis] = worldPosition[axis] - chunkCoord[axis] * Chunk::ChunkSize;
+	}
+	return chunkCoord;
+}
+
+Voxel World::getVoxel(glm::ivec3 worldPosition) const
+{
+	glm::ivec3 localPosition;
+	const Chunk* chunk = getChunk(splitWorldPosition(worldPosition, localPosition));
+	if (chunk == nullptr)
+		return _farStorage ? _farStorage->getVoxel(worldPosition) : Voxel((uint16_t)Voxel::Type::air);
+
+	return chunk->getVoxel(localPosition.x, localPosition.y, localPosition.z);
+}
+
+void World::setVoxel(glm::ivec3 worldPosition, Voxel voxel)
+{
+	glm::ivec3 localPosition;
+	glm::ivec3 chunkCoord = splitWorldPosition(worldPosition, localPosition);
+	ChunkHandle handle = _chunkMap.find(chunkCoord);
+	if (handle == InvalidChunkHandle)
+		return;
+
+	Chunk& chunk = chunks[handle];
+	chunk.setVoxel(localPosition.x, localPosition.y, localPosition.z, voxel);
+	if (chunk.isSetup)
+		_rebuildList.push(handle, getChunkPriority(handle));
+
+	// the faces of the voxels next to the edited one may appear or disappear, their sections are meshed again
+	// whether they are in this chunk or across the border in the neighbour
+	for (int axis = 0; axis < 3; axis++)
+	{
+		for (int direction : { -1, 1 })
+		{
+			glm::ivec3 next = localPosition;
+			next[axis] += direction;
+			if (Chunk::isInside(next.x, next.y, next.z))
+			{
+				if (Chunk::getSectionIndex(next.x, next.y, next.z) != Chunk::getSectionIndex(localPosition.x, localPosition.y, localPosition.z))
+					chunk.markDirty(next.x, next.y, next.z);
+				continue;
+			}
+
+			glm::ivec3 offset(0);
+			offset[axis] = direction;
+			next[axis] -= direction * Chunk::ChunkSize;
+			if (Chunk* neighbour = getChunk(chunkCoord + offset))
+				neighbour->markDirty(next.x, next.y, next.z);
+		}
+	}
 }
 
 void World::update(float dt, glm::vec3 cameraPos, glm::vec3 cameraView)
 {
+	// priorities are computed from the camera of this frame
+	bool cameraMoved = cameraPos != _cameraPos || cameraView != _cameraView;
+	if (cameraMoved)
+		_forceVisibilityUpdate = true;
+
+	_cameraPos = cameraPos;
+	_cameraView = cameraView;
+
 	updateAsyncChunker();
 	updateLoadList();
 	updateSetupList();
 	updateRebuildList();
 	updateFlagsList();
 	updateUnloadList();
+
+	bool visibilityChanged = _forceVisibilityUpdate;
 	updateVisibilityList(cameraPos);
 
-	if(cameraPos != _cameraPos || cameraView != _cameraView)
+	if (visibilityChanged)
 		updateRenderList();
-	
-	_cameraPos = cameraPos;
-	_cameraView = cameraView;
 }
 
 void World::updateAsyncChunker()
@@ -57,130 +265,271 @@ void World::updateAsyncChunker()
 
 }
 
-// iterate over the pending load chunk list and load chunks
-// loadList is cleared every frame and gets re-updated in the visibility update step
-// TODO : add additionnal code to limit the number of chunks loaded per frame
+// load the pending chunks by priority, within the load budget
+// loadList gets re-updated in the visibility update step, chunks over budget wait there for the next frames
 void World::updateLoadList()
 {
-	int chunkLoadedCount = 0;
-	for (int i = 0; i < _loadList.size(); i++)
-	{
-		Chunk& chunk = _loadList[i];
+	uint32_t processedCount = runStage(Stage::load, _loadList, [this](Chunk& chunk) {
 		if (!chunk.isLoaded)
 		{
+			// the far storage is only read during the load stage, it is safe to share between the workers
+			bool isStored = _farStorage && _farStorage->loadChunk(chunk.coord, chunk);
+			if (!isStored && _chunkGenerator)
+				_chunkGenerator(chunk);
 			chunk.load();
-			chunkLoadedCount++;
-			_forceVisibilityUpdate = true;
 		}
-	}
-	_loadList.clear();
+	});
+
+	for (ChunkHandle handle : _stageChunks)
+		touchNeighbours(chunks[handle].coord);
+
+	if (processedCount > 0)
+		_forceVisibilityUpdate = true;
 }
 
-// iterate over the pending setup chunk list and setup chunks
-// setupList is cleared every frame and gets re-updated in the visibility update step
-// TODO : add additionnal code to limit the number of chunks loaded per frame
+// setup the pending chunks by priority, within the setup budget
+// setupList gets re-updated in the visibility update step, chunks over budget wait there for the next frames
 void World::updateSetupList()
 {
-	for (int i = 0; i < _setupList.size(); i++)
-	{
-		Chunk& chunk = _setupList[i];
+	uint32_t processedCount = runStage(Stage::setup, _setupList, [](Chunk& chunk) {
 		if (chunk.isLoaded && !chunk.isSetup)
-		{
 			chunk.setup();
+	});
 
-			if(chunk.isSetup)
-				_forceVisibilityUpdate = true;
-		}
-	}
-	_setupList.clear();
+	if (processedCount > 0)
+		_forceVisibilityUpdate = true;
 }
 
-// iterate over the pending rebuild chunk list and rebuild chunks
-// rebuildList is cleared every frame and gets re-updated in the visibility update step
-// TODO : add additionnal code to limit the number of chunks loaded per frame
+// rebuild the pending chunks by priority, within the rebuild budget
+// rebuildList is filled by the voxel edits (once per chunk), chunks over budget stay in it for the next frames
 // TODO : add neighbors to flagsList for update their state
 void World::updateRebuildList()
 {
-	int chunkRebuiltCount = 0;
-	for (int i = 0; i < _rebuildList.size(); i++)
+	runStage(Stage::rebuild, _rebuildList, [](Chunk& chunk) {
+		if (chunk.isLoaded && chunk.isSetup)
+			chunk.rebuild();
+	});
+
+	for (ChunkHandle handle : _stageChunks)
 	{
-		Chunk& chunk = _rebuildList[i];
+		const Chunk& chunk = chunks[handle];
 		if (chunk.isLoaded && chunk.isSetup)
 		{
-			chunk.rebuild();
-			_flagsList.push_back(chunk);
+			_flagsList.push_back(handle);
 
 			// add neighbors to flag list for update too
 			// ...
-			
-			chunkRebuiltCount++;
+
 			_forceVisibilityUpdate = true;
 		}
 	}
-	_rebuildList.clear();
 }
 
-//
+// TODO : update the flags of the rebuilt chunks and of their neighbors
 void World::updateFlagsList()
 {
-	
+	_flagsList.clear();
 }
 
-// iterate over the pending unload chunk list and unload chunks
+// iterate over the pending unload chunk list, unload the chunks then destroy them
 // unloadList is cleared every frame and gets re-updated in the visibility update step
 void World::updateUnloadList()
 {
-	for (int i = 0; i < _unloadList.size(); i++)
+	// the far storage is written by one thread at a time
+	if (_farStorage)
 	{
-		Chunk& chunk = _unloadList[i];
-		if (chunk.isLoaded)
+		for (ChunkHandle handle : _unloadList)
 		{
-			chunk.unload();
-			_forceVisibilityUpdate = true;
+			if (chunks[handle].isLoaded)
+				_farStorage->storeChunk(chunks[handle]);
 		}
+
+		// every chunk streaming back out overwrites its stored copy, the nodes only the old copy used are
+		// dropped once enough copies were replaced to pay for a pass over the whole dag
+		size_t collectThreshold = std::max<size_t>(FarStorageMinCollectCount, _farStorage->getChunkCount() / 4);
+		if (_farStorage->getReplacedRootCount() >= collectThreshold)
+			_farStorage->collectGarbage();
 	}
+
+	forEachChunk(_unloadList.data(), _unloadList.size(), [](Chunk& chunk) {
+		if (chunk.isLoaded)
+			chunk.unload();
+	});
+
+	for (ChunkHandle handle : _unloadList)
+		destroyChunk(handle);
+
+	if (!_unloadList.empty())
+		_forceVisibilityUpdate = true;
 	_unloadList.clear();
 }
 
-void World::updateVisibilityList(glm::vec3 cameraPos)
+uint32_t World::runStage(Stage stage, ChunkQueue& queue, const std::function<void(Chunk&)>& work)
+{
+	const StageBudget& budget = _stageBudgets[(size_t)stage];
+	StageStats& stats = _stageStats[(size_t)stage];
+
+	auto start = std::chrono::high_resolution_clock::now();
+	auto getElapsedMs = [&start]() {
+		return std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	};
+
+	size_t chunkLimit = queue.size();
+	if (budget.maxChunkCount > 0)
+		chunkLimit = std::min(chunkLimit, (size_t)budget.maxChunkCount);
+
+	// with a time budget the chunks go in small batches, one chunk per worker, so the clock is checked often
+	size_t batchSize = chunkLimit;
+	if (budget.maxMilliseconds > 0.0f)
+		batchSize = _taskScheduler ? _taskScheduler->getThreadCount() + 1 : 1;
+
+	_stageChunks.clear();
+	while (_stageChunks.size() < chunkLimit)
+	{
+		if (!_stageChunks.empty() && budget.maxMilliseconds > 0.0f && getElapsedMs() >= budget.maxMilliseconds)
+			break;
+
+		size_t first = _stageChunks.size();
+		size_t count = std::min(batchSize, chunkLimit - first);
+		for (size_t i = 0; i < count; i++)
+			_stageChunks.push_back(queue.pop());
+
+		forEachChunk(_stageChunks.data() + first, count, work);
+	}
+
+	stats.processedCount = static_cast<uint32_t>(_stageChunks.size());
+	stats.deferredCount = static_cast<uint32_t>(queue.size());
+	stats.milliseconds = getElapsedMs();
+	return stats.processedCount;
+}
+
+void World::forEachChunk(const ChunkHandle* chunkList, size_t count, const std::function<void(Chunk&)>& work)
 {
-	const static int radius = 4;
+	// not worth a task for a single chunk
+	if (_taskScheduler == nullptr || count < 2)
+	{
+		for (size_t i = 0; i < count; i++)
+			work(chunks[chunkList[i]]);
+		return;
+	}
+
+	_chunkTasks.clear();
+	for (size_t i = 0; i < count; i++)
+	{
+		// chunks is not resized while the stage runs, and two pointers fit in the small buffer of std::function
+		Chunk* chunk = &chunks[chunkList[i]];
+		_chunkTasks.push_back(_taskScheduler->submit([chunk, &work]() { work(*chunk); }));
+	}
 
+	// the stage is over once its join task, which depends on every chunk task, has run
+	TaskScheduler::TaskHandle stage = _taskScheduler->submit([]() {}, _chunkTasks);
+	_chunkTasks.clear();
+	_taskScheduler->wait(stage);
+}
+
+// the queues are kept between passes : chunks already queued only get their priority moved in place
+void World::updateVisibilityList(glm::vec3 cameraPos)
+{
 	// update visibility list
 	if (_forceVisibilityUpdate)
 	{
-		for (int chunkIndex = 0; chunkIndex < chunks.size(); chunkIndex++)
-		{
-			glm::vec3 chunkPosition(chunkIndex % WorldSize,
-								   (chunkIndex / WorldSize) % WorldSize,
-								   (chunkIndex / (WorldSize * WorldSize)) % WorldSize);
+		_forceVisibilityUpdate = false;
+		_visibilityList.clear();
 
-			Chunk& chunk = chunks[chunkIndex];
+		// radius is in chunks, the camera is in voxels
+		glm::vec3 cameraChunkPosition = cameraPos / (float)Chunk::ChunkSize;
+		glm::ivec3 cameraChunk = glm::ivec3(glm::floor(cameraChunkPosition));
 
-			if (glm::distance(chunkPosition, cameraPos) < radius)
+		// create the chunks that came in range, the store and the map only grow past their largest size so far
+		for (int z = -VisibilityRadius; z <= VisibilityRadius; z++)
+		{
+			for (int y = -VisibilityRadius; y <= VisibilityRadius; y++)
 			{
-				if(!chunk.isLoaded)
-					_loadList.push_back(chunk);
-				else if(!chunk.isSetup)
-					_setupList.push_back(chunk);
-				else
-					_visibilityList.push_back(chunk);
+				for (int x = -VisibilityRadius; x <= VisibilityRadius; x++)
+				{
+					glm::ivec3 chunkCoord = cameraChunk + glm::ivec3(x, y, z);
+					glm::vec3 chunkCenter = glm::vec3(chunkCoord) + glm::vec3(0.5f);
+					if (glm::distance(chunkCenter, cameraChunkPosition) >= VisibilityRadius)
+						continue;
+
+					ChunkHandle handle = createChunk(chunkCoord);
+					const Chunk& chunk = chunks[handle];
+
+					if(!chunk.isLoaded)
+						_loadList.push(handle, getChunkPriority(handle));
+					else if(!chunk.isSetup)
+						_setupList.push(handle, getChunkPriority(handle));
+					else
+						_visibilityList.push_back(handle);
+				}
 			}
 		}
+
+		// the chunks out of range are destroyed by the next unload step
+		_chunkMap.forEach([&](glm::ivec3 chunkCoord, ChunkHandle handle) {
+			glm::vec3 chunkCenter = glm::vec3(chunkCoord) + glm::vec3(0.5f);
+			if (glm::distance(chunkCenter, cameraChunkPosition) < VisibilityRadius)
+				return;
+
+			// left the radius before its turn came
+			_loadList.remove(handle);
+			_setupList.remove(handle);
+
+			_unloadList.push_back(handle);
+		});
+
+		_rebuildList.reprioritize([this](ChunkHandle handle) { return getChunkPriority(handle); });
 	}
 }
 
 void World::updateRenderList()
 {
 	renderList.clear();
-	for (int i = 0; i < _visibilityList.size(); i++)
+	for (ChunkHandle handle : _visibilityList)
 	{
-		Chunk& chunk = _visibilityList[i];
+		const Chunk& chunk = chunks[handle];
 		if (chunk.isLoaded && chunk.isSetup && chunk.shouldRender)
 		{
 			// TODO : check if chunk is visible (Frustrum culling)
-			renderList.push_back(chunk);
+			renderList.push_back(handle);
 		}
 	}
-	_unloadList.clear();
+
+	// the render system meshes new chunks in this order, and drawing front to back helps the depth test
+	std::sort(renderList.begin(), renderList.end(), [this](ChunkHandle a, ChunkHandle b) {
+		return getChunkPriority(a) < getChunkPriority(b);
+	});
+}
+
+float World::getChunkPriority(ChunkHandle chunk) const
+{
+	glm::vec3 cameraChunkPosition = _cameraPos / (float)Chunk::ChunkSize;
+	glm::vec3 chunkCenter = glm::vec3(chunks[chunk].coord) + glm::vec3(0.5f);
+
+	float priority = glm::distance(chunkCenter, cameraChunkPosition);
+	if (!isInView(chunkCenter, cameraChunkPosition))
+		priority += VisibilityRadius;
+
+	return priority;
+}
+
+// cone around the view direction, a bit wider than the 50 degrees vertical fov so that wide windows are covered
+// _cameraView holds the yaw, pitch and roll angles given to VvbCamera::setViewYXZ
+bool World::isInView(glm::vec3 chunkCenter, glm::vec3 cameraChunkPosition) const
+{
+	const float viewConeHalfAngle = glm::radians(50.0f);
+	const float chunkRadius = 0.87f; // half of the cube diagonal
+
+	glm::vec3 toChunk = chunkCenter - cameraChunkPosition;
+	float distance = glm::length(toChunk);
+	if (distance <= chunkRadius)
+		return true;
+
+	// same forward axis as the view matrix of setViewYXZ
+	float pitch = _cameraView.x;
+	float yaw = _cameraView.y;
+	glm::vec3 forward(glm::cos(pitch) * glm::sin(yaw), -glm::sin(pitch), glm::cos(pitch) * glm::cos(yaw));
+
+	float angle = glm::acos(glm::clamp(glm::dot(forward, toChunk / distance), -1.0f, 1.0f));
+	return angle <= viewConeHalfAngle + glm::asin(chunkRadius / distance);
 }
@@ -0,0 +1,261 @@
+// vulkan base
+#include "model/voxel_block_pool.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+// set once the cache of the thread is destroyed, blocks freed after that go straight to the shared lists
+static thread_local bool isThreadCacheRetired = false;
+
+VoxelBlockPool& VoxelBlockPool::get()
+{
+	static VoxelBlockPool* pool = new VoxelBlockPool();
+	return *pool;
+}
+
+uint32_t VoxelBlockPool::getSizeClass(uint32_t wordCount)
+{
+	uint32_t sizeClass = 0;
+	while ((1u << sizeClass) < wordCount)
+		sizeClass++;
+
+	assert(sizeClass < SizeClassCount && "voxel block too large for the pool");
+	return sizeClass;
+}
+
+VoxelBlockPool::ThreadCache::ThreadCache()
+{
+	VoxelBlockPool& pool = VoxelBlockPool::get();
+	std::lock_guard<std::mutex> lock(pool.mutex);
+	pool.threadCaches.push_back(this);
+}
+
+VoxelBlockPool::ThreadCache::~ThreadCache()
+{
+	VoxelBlockPool& pool = VoxelBlockPool::get();
+	for (uint32_t sizeClass = 0; sizeClass < SizeClassCount; sizeClass++)
+		pool.flush(*this, sizeClass, 0);
+
+	std::lock_guard<std::mutex> lock(pool.mutex);
+	pool.retiredAllocations += allocations;
+	pool.retiredFrees += frees;
+	pool.retiredThreadCacheHits += threadCacheHits;
+	pool.retiredUsedWords += usedWords;
+	pool.threadCaches.erase(std::find(pool.threadCaches.begin(), pool.threadCaches.end(), this));
+	isThreadCacheRetired = true;
+}
+
+VoxelBlockPool::ThreadCache* VoxelBlockPool::getThreadCache()
+{
+	if (isThreadCacheRetired)
+		return nullptr;
+
+	thread_local ThreadCache cache;
+	return &cache;
+}
+
+uint64_t* VoxelBlockPool::allocate(uint32_t wordCount)
+{
+	uint32_t sizeClass = getSizeClass(wordCount);
+	uint32_t classWordCount = getClassWordCount(sizeClass);
+
+	ThreadCache* cache = getThreadCache();
+	if (cache == nullptr)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		retiredAllocations++;
+		retiredUsedWords += classWordCount;
+		if (!freeBlocks[sizeClass].empty())
+		{
+			uint64_t* block = freeBlocks[sizeClass].back();
+			freeBlocks[sizeClass].pop_back();
+			return block;
+		}
+
+		systemAllocations++;
+		reservedWords += classWordCount;
+		return new uint64_t[classWordCount];
+	}
+
+	if (cache->blockCounts[sizeClass] == 0)
+		refill(*cache, sizeClass);
+	else
+		cache->threadCacheHits.store(cache->threadCacheHits.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+
+	cache->allocations.store(cache->allocations.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+	cache->usedWords.store(cache->usedWords.load(std::memory_order_relaxed) + classWordCount, std::memory_order_relaxed);
+	return cache->blocks[sizeClass][--cache->blockCounts[sizeClass]];
+}
+
+void VoxelBlockPool::free(uint64_t* block, uint32_t wordCount)
+{
+	if (block == nullptr)
+		return;
+
+	uint32_t sizeClass = getSizeClass(wordCount);
+	uint32_t classWordCount = getClassWordCount(sizeClass);
+
+	ThreadCache* cache = getThreadCache();
+	if (cache == nullptr)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		retiredFrees++;
+		retiredUsedWords -= classWordCount;
+		freeBlocks[sizeClass].push_back(block);
+		return;
+	}
+
+	// a full cache keeps room for the next frees, and enough blocks for the next allocations
+	if (cache->blockCounts[sizeClass] == ThreadCacheSize)
+		flush(*cache, sizeClass, ThreadCacheSize - BatchSize);
+
+	cache->frees.store(cache->frees.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+	cache->usedWords.store(cache->usedWords.load(std::memory_order_relaxed) - classWordCount, std::memory_order_relaxed);
+	cache->blocks[sizeClass][cache->blockCounts[sizeClass]++] = block;
+}
+
+void VoxelBlockPool::trim()
+{
+	ThreadCache* cache = getThreadCache();
+	if (cache != nullptr)
+	{
+		for (uint32_t sizeClass = 0; sizeClass < SizeClassCount; sizeClass++)
+			flush(*cache, sizeClass, 0);
+	}
+
+	std::lock_guard<std::mutex> lock(mutex);
+	for (uint32_t sizeClass = 0; sizeClass < SizeClassCount; sizeClass++)
+	{
+		for (uint64_t* block : freeBlocks[sizeClass])
+			delete[] block;
+
+		reservedWords -= freeBlocks[sizeClass].size() * getClassWordCount(sizeClass);
+		freeBlocks[sizeClass].clear();
+		freeBlocks[sizeClass].shrink_to_fit();
+	}
+}
+
+VoxelBlockPool::Stats VoxelBlockPool::getStats() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	Stats stats;
+	stats.allocations = retiredAllocations;
+	stats.frees = retiredFrees;
+	stats.threadCacheHits = retiredThreadCacheHits;
+	int64_t usedWords = retiredUsedWords;
+	for (const ThreadCache* cache : threadCaches)
+	{
+		stats.allocations += cache->allocations.load(std::memory_order_relaxed);
+		stats.frees += cache->frees.load(std::memory_order_relaxed);
+		stats.threadCacheHits += cache->threadCacheHits.load(std::memory_order_relaxed);
+		usedWords += cache->usedWords.load(std::memory_order_relaxed);
+	}
+
+	stats.systemAllocations = systemAllocations;
+	stats.reservedBytes = reservedWords * sizeof(uint64_t);
+	stats.usedBytes = static_cast<size_t>(std::max<int64_t>(usedWords, 0)) * sizeof(uint64_t);
+	return stats;
+}
+
+void VoxelBlockPool::refill(ThreadCache& cache, uint32_t sizeClass)
+{
+	uint32_t classWordCount = getClassWordCount(sizeClass);
+
+	std::lock_guard<std::mutex> lock(mutex);
+	std::vector<uint64_t*>& blocks = freeBlocks[sizeClass];
+	while (cache.blockCounts[sizeClass] < BatchSize && !blocks.empty())
+	{
+		cache.blocks[sizeClass][cache.blockCounts[sizeClass]++] = blocks.back();
+		blocks.pop_back();
+	}
+
+	// the shared list is empty : one block from the system, the pool grows only as much as it is used
+	if (cache.blockCounts[sizeClass] == 0)
+	{
+		systemAllocations++;
+		reservedWords += classWordCount;
+		cache.blocks[sizeClass][cache.blockCounts[sizeClass]++] = new uint64_t[classWordCount];
+	}
+}
+
+void VoxelBlockPool::flush(ThreadCache& cache, uint32_t sizeClass, uint32_t keepCount)
+{
+	if (cache.blockCounts[sizeClass] <= keepCount)
+		return;
+
+	std::lock_guard<std::mutex> lock(mutex);
+	while (cache.blockCounts[sizeClass] > keepCount)
+		freeBlocks[sizeClass].push_back(cache.blocks[sizeClass][--cache.blockCounts[sizeClass]]);
+}
+
+VoxelBlock::VoxelBlock(const VoxelBlock& other)
+{
+	*this = other;
+}
+
+VoxelBlock& VoxelBlock::operator=(const VoxelBlock& other)
+{
+	if (this == &other)
+		return *this;
+
+	assign(other.wordCount, 0);
+	if (wordCount > 0)
+		std::memcpy(words, other.words, wordCount * sizeof(uint64_t));
+	return *this;
+}
+
+VoxelBlock::VoxelBlock(VoxelBlock&& other) noexcept
+	: words(other.words), wordCount(other.wordCount)
+{
+	other.words = nullptr;
+	other.wordCount = 0;
+}
+
+VoxelBlock& VoxelBlock::operator=(VoxelBlock&& other) noexcept
+{
+	if (this == &other)
+		return *this;
+
+	reset();
+	std::swap(words, other.words);
+	std::swap(wordCount, other.wordCount);
+	return *this;
+}
+
+void VoxelBlock::assign(uint32_t newWordCount, uint64_t value)
+{
+	if (newWordCount == 0)
+	{
+		reset();
+		return;
+	}
+
+	if (words == nullptr || VoxelBlockPool::getSizeClass(newWordCount) != VoxelBlockPool::getSizeClass(wordCount))
+	{
+		reset();
+		words = VoxelBlockPool::get().allocate(newWordCount);
+	}
+
+	wordCount = newWordCount;
+	std::fill(words, words + wordCount, value);
+}
+
+void VoxelBlock::reset()
+{
+	if (words == nullptr)
+		return;
+
+	VoxelBlockPool::get().free(words, wordCount);
+	words = nullptr;
+	wordCount = 0;
+}
+
+size_t VoxelBlock::getMemoryUsage() const
+{
+	if (words == nullptr)
+		return 0;
+	return VoxelBlockPool::getClassWordCount(VoxelBlockPool::getSizeClass(wordCount)) * sizeof(uint64_t);
+}
@@ -0,0 +1,195 @@
+// vulkan base
+#include "model/voxel_dag.hpp"
+
+// std
+#include <cassert>
+
+void VoxelDag::storeChunk(const Chunk& chunk)
+{
+	NodeRef root;
+	if (chunk.voxels.isUniform())
+	{
+		root = makeLeaf(chunk.voxels.get(0));
+	}
+	else
+	{
+		// the builder reads the voxels many times, decode them once
+		thread_local std::vector<Voxel> voxels;
+		voxels.resize(chunk.voxels.getVoxelCount());
+		chunk.voxels.decode(voxels.data());
+		root = build(voxels, 0, 0, 0, Chunk::ChunkSize);
+	}
+
+	if (roots.erase(chunk.coord))
+		replacedRootCount++;
+	roots.insert(chunk.coord, root);
+}
+
+bool VoxelDag::loadChunk(glm::ivec3 chunkCoord, Chunk& chunk) const
+{
+	NodeRef root = roots.find(chunkCoord);
+	if (root == InvalidChunkHandle)
+		return false;
+
+	if (isLeaf(root))
+	{
+		chunk.voxels.fill(getLeafVoxel(root));
+		return true;
+	}
+
+	thread_local std::vector<Voxel> voxels;
+	voxels.resize(chunk.voxels.getVoxelCount());
+	decode(root, 0, 0, 0, Chunk::ChunkSize, voxels);
+	chunk.voxels.encode(voxels.data());
+	return true;
+}
+
+Voxel VoxelDag::getVoxel(glm::ivec3 worldPosition) const
+{
+	glm::ivec3 chunkCoord;
+	glm::ivec3 localPosition;
+	for (int axis = 0; axis < 3; axis++)
+	{
+		chunkCoord[axis] = worldPosition[axis] >= 0
+			? worldPosition[axis] / Chunk::ChunkSize
+			: (worldPosition[axis] + 1) / Chunk::ChunkSize - 1;
+		localPosition[axis] = worldPosition[axis] - chunkCoord[axis] * Chunk::ChunkSize;
+	}
+
+	NodeRef ref = roots.find(chunkCoord);
+	if (ref == InvalidChunkHandle)
+		return Voxel((uint16_t)Voxel::Type::air);
+
+	// one level per bit of the local position, from the highest one
+	for (int level = ChunkLevels - 1; !isLeaf(ref); level--)
+	{
+		int child = ((localPosition.x >> level) & 1) | (((localPosition.y >> level) & 1) << 1) | (((localPosition.z >> level) & 1) << 2);
+		ref = nodes[ref].children[child];
+	}
+	return getLeafVoxel(ref);
+}
+
+void VoxelDag::collectGarbage()
+{
+	// nodes only point to nodes created before them, so walking backwards from the roots marks
+	// everything reachable in one pass
+	std::vector<bool> isReachable(nodes.size(), false);
+	roots.forEach([&](glm::ivec3, NodeRef root) {
+		if (!isLeaf(root))
+			isReachable[root] = true;
+	});
+
+	for (size_t index = nodes.size(); index-- > 0;)
+	{
+		if (!isReachable[index])
+			continue;
+
+		for (NodeRef child : nodes[index].children)
+		{
+			if (!isLeaf(child))
+				isReachable[child] = true;
+		}
+	}
+
+	// compact the kept nodes, in the same order so children stay before their parents
+	std::vector<NodeRef> remap(nodes.size(), 0);
+	std::vector<Node> keptNodes;
+	for (size_t index = 0; index < nodes.size(); index++)
+	{
+		if (!isReachable[index])
+			continue;
+
+		Node node = nodes[index];
+		for (NodeRef& child : node.children)
+		{
+			if (!isLeaf(child))
+				child = remap[child];
+		}
+
+		remap[index] = static_cast<NodeRef>(keptNodes.size());
+		keptNodes.push_back(node);
+	}
+
+	nodes.swap(keptNodes);
+	nodeIndices.clear();
+	for (size_t index = 0; index < nodes.size(); index++)
+		nodeIndices.emplace(nodes[index], static_cast<NodeRef>(index));
+
+	ChunkMap keptRoots;
+	roots.forEach([&](glm::ivec3 chunkCoord, NodeRef root) {
+		keptRoots.insert(chunkCoord, isLeaf(root) ? root : remap[root]);
+	});
+	std::swap(roots, keptRoots);
+	replacedRootCount = 0;
+}
+
+size_t VoxelDag::getMemoryUsage() const
+{
+	// an unordered_map entry is a node of its own plus a bucket pointer
+	size_t tableEntrySize = sizeof(Node) + sizeof(NodeRef) + 2 * sizeof(void*);
+	return getNodeMemoryUsage()
+		+ nodeIndices.size() * tableEntrySize + nodeIndices.bucket_count() * sizeof(void*)
+		+ roots.capacity() * (sizeof(glm::ivec3) + sizeof(ChunkHandle));
+}
+
+VoxelDag::NodeRef VoxelDag::build(const std::vector<Voxel>& voxels, int x, int y, int z, int size)
+{
+	if (size == 1)
+		return makeLeaf(voxels[Chunk::getVoxelIndex(x, y, z)]);
+
+	int half = size / 2;
+	Node node;
+	for (int child = 0; child < 8; child++)
+		node.children[child] = build(voxels, x + (child & 1) * half, y + ((child >> 1) & 1) * half, z + ((child >> 2) & 1) * half, half);
+
+	// 8 identical leaves merge into a bigger leaf
+	bool isUniform = isLeaf(node.children[0]);
+	for (int child = 1; isUniform && child < 8; child++)
+		isUniform = node.children[child] == node.children[0];
+
+	return isUniform ? node.children[0] : intern(node);
+}
+
+VoxelDag::NodeRef VoxelDag::intern(const Node& node)
+{
+	auto it = nodeIndices.find(node);
+	if (it != nodeIndices.end())
+		return it->second;
+
+	assert(nodes.size() < LeafBit && "voxel dag is full");
+
+	NodeRef ref = static_cast<NodeRef>(nodes.size());
+	nodes.push_back(node);
+	nodeIndices.emplace(node, ref);
+	return ref;
+}
+
+void VoxelDag::decode(NodeRef ref, int x, int y, int z, int size, std::vector<Voxel>& voxels) const
+{
+	if (isLeaf(ref))
+	{
+		Voxel voxel = getLeafVoxel(ref);
+		for (int k = z; k < z + size; k++)
+			for (int j = y; j < y + size; j++)
+				for (int i = x; i < x + size; i++)
+					voxels[Chunk::getVoxelIndex(i, j, k)] = voxel;
+		return;
+	}
+
+	int half = size / 2;
+	const Node& node = nodes[ref];
+	for (int child = 0; child < 8; child++)
+		decode(node.children[child], x + (child & 1) * half, y + ((child >> 1) & 1) * half, z + ((child >> 2) & 1) * half, half, voxels);
+}
+
+size_t VoxelDag::NodeHash::operator()(const Node& node) const
+{
+	uint64_t hash = 0xCBF29CE484222325ull;
+	for (NodeRef child : node.children)
+	{
+		hash ^= child;
+		hash *= 0x100000001B3ull;
+		hash ^= hash >> 29;
+	}
+	return static_cast<size_t>(hash);
+}
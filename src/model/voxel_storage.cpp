@@ -0,0 +1,200 @@
+// vulkan base
+#include "model/voxel.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+
+VoxelStorage::VoxelStorage(uint32_t voxelCount, Voxel voxel)
+	: voxelCount(voxelCount)
+{
+	fill(voxel);
+}
+
+void VoxelStorage::set(uint32_t index, Voxel voxel)
+{
+	assert(index < voxelCount && "voxel index out of range");
+
+	uint32_t paletteIndex = findPaletteIndex(voxel);
+	if (paletteIndex == palette.size())
+	{
+		palette.push_back(voxel);
+		if (palette.size() > (1u << bits))
+			setBitsPerVoxel(bits == 0 ? 1 : bits * 2);
+	}
+
+	setPaletteIndex(index, paletteIndex);
+}
+
+void VoxelStorage::fill(Voxel voxel)
+{
+	palette.assign(1, voxel);
+	lastPaletteIndex = 0;
+	resetIndices(0);
+}
+
+// the width is a constant here so the loop over a word is fully unrolled
+template<uint32_t Bits>
+static void decodeIndices(const uint64_t* words, const Voxel* palette, Voxel* voxels, uint32_t voxelCount)
+{
+	const uint32_t indicesPerWord = 64 / Bits;
+	const uint64_t mask = (1ull << Bits) - 1;
+
+	uint32_t fullWordCount = voxelCount / indicesPerWord;
+	for (uint32_t wordIndex = 0; wordIndex < fullWordCount; wordIndex++)
+	{
+		uint64_t word = words[wordIndex];
+		Voxel* out = voxels + wordIndex * indicesPerWord;
+		for (uint32_t i = 0; i < indicesPerWord; i++)
+			out[i] = palette[(word >> (i * Bits)) & mask];
+	}
+
+	for (uint32_t index = fullWordCount * indicesPerWord; index < voxelCount; index++)
+		voxels[index] = palette[(words[index / indicesPerWord] >> ((index % indicesPerWord) * Bits)) & mask];
+}
+
+void VoxelStorage::decode(Voxel* voxels) const
+{
+	switch (bits)
+	{
+	case 0: std::fill(voxels, voxels + voxelCount, palette[0]); break;
+	case 1: decodeIndices<1>(words.data(), palette.data(), voxels, voxelCount); break;
+	case 2: decodeIndices<2>(words.data(), palette.data(), voxels, voxelCount); break;
+	case 4: decodeIndices<4>(words.data(), palette.data(), voxels, voxelCount); break;
+	case 8: decodeIndices<8>(words.data(), palette.data(), voxels, voxelCount); break;
+	case 16: decodeIndices<16>(words.data(), palette.data(), voxels, voxelCount); break;
+	default: assert(false && "unsupported voxel index width");
+	}
+}
+
+void VoxelStorage::encode(const Voxel* voxels)
+{
+	// gather the palette first so the indices are packed only once, at their final width
+	palette.clear();
+	lastPaletteIndex = 0;
+	for (uint32_t index = 0; index < voxelCount; index++)
+	{
+		if (findPaletteIndex(voxels[index]) == palette.size())
+			palette.push_back(voxels[index]);
+	}
+
+	if (palette.empty())
+		palette.push_back(Voxel());
+
+	resetIndices(getBitsForPaletteSize(palette.size()));
+	for (uint32_t index = 0; index < voxelCount; index++)
+		setPaletteIndex(index, findPaletteIndex(voxels[index]));
+}
+
+void VoxelStorage::compact()
+{
+	std::vector<uint32_t> counts(palette.size(), 0);
+	for (uint32_t index = 0; index < voxelCount; index++)
+		counts[getPaletteIndex(index)]++;
+
+	if (std::find(counts.begin(), counts.end(), 0u) == counts.end() && bits == getBitsForPaletteSize(palette.size()))
+		return;
+
+	// old palette index to new one, the entries keep their order
+	std::vector<uint32_t> remap(palette.size(), 0);
+	std::vector<Voxel> usedPalette;
+	for (size_t i = 0; i < palette.size(); i++)
+	{
+		if (counts[i] == 0)
+			continue;
+
+		remap[i] = static_cast<uint32_t>(usedPalette.size());
+		usedPalette.push_back(palette[i]);
+	}
+
+	// repack from the old packed indices, moved out rather than copied
+	VoxelBlock oldWords = std::move(words);
+	uint32_t oldBits = bits;
+	uint32_t oldIndexShift = indexShift;
+	palette.swap(usedPalette);
+	lastPaletteIndex = 0;
+
+	resetIndices(getBitsForPaletteSize(palette.size()));
+
+	for (uint32_t index = 0; index < voxelCount; index++)
+		setPaletteIndex(index, remap[readPaletteIndex(oldWords, oldBits, oldIndexShift, index)]);
+}
+
+bool VoxelStorage::hasSolidType() const
+{
+	return std::any_of(palette.begin(), palette.end(), [](const Voxel& voxel) { return voxel.isSolid(); });
+}
+
+size_t VoxelStorage::getMemoryUsage() const
+{
+	return words.getMemoryUsage() + palette.capacity() * sizeof(Voxel);
+}
+
+void VoxelStorage::setPaletteIndex(uint32_t index, uint32_t paletteIndex)
+{
+	if (bits == 0)
+		return;
+
+	uint32_t shift = (index & ((1u << indexShift) - 1)) * bits;
+	uint64_t mask = ((1ull << bits) - 1) << shift;
+
+	uint64_t& word = words[index >> indexShift];
+	word = (word & ~mask) | (static_cast<uint64_t>(paletteIndex) << shift);
+}
+
+// palette.size() when the type is not in the palette yet
+uint32_t VoxelStorage::findPaletteIndex(Voxel voxel)
+{
+	if (lastPaletteIndex < palette.size() && palette[lastPaletteIndex].id == voxel.id)
+		return lastPaletteIndex;
+
+	for (uint32_t i = 0; i < palette.size(); i++)
+	{
+		if (palette[i].id == voxel.id)
+		{
+			lastPaletteIndex = i;
+			return i;
+		}
+	}
+	return static_cast<uint32_t>(palette.size());
+}
+
+void VoxelStorage::setBitsPerVoxel(uint32_t newBits)
+{
+	assert(newBits <= 16 && palette.size() <= (1u << newBits) && "palette doesn't fit the index width");
+
+	VoxelBlock oldWords = std::move(words);
+	uint32_t oldBits = bits;
+	uint32_t oldIndexShift = indexShift;
+	resetIndices(newBits);
+	for (uint32_t index = 0; index < voxelCount; index++)
+		setPaletteIndex(index, readPaletteIndex(oldWords, oldBits, oldIndexShift, index));
+}
+
+void VoxelStorage::resetIndices(uint32_t newBits)
+{
+	bits = newBits;
+	if (bits == 0)
+	{
+		indexShift = 0;
+		words.reset();
+		return;
+	}
+
+	indexShift = 6;
+	for (uint32_t width = bits; width > 1; width /= 2)
+		indexShift--;
+
+	words.assign((voxelCount + (1u << indexShift) - 1) >> indexShift, 0);
+}
+
+uint32_t VoxelStorage::getBitsForPaletteSize(size_t paletteSize)
+{
+	if (paletteSize <= 1)
+		return 0;
+
+	uint32_t newBits = 1;
+	while ((1u << newBits) < paletteSize)
+		newBits *= 2;
+	return newBits;
+}
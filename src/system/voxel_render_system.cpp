@@ -2,12 +2,22 @@
 #include "system/voxel_render_system.hpp"
 
 // std
+#include <algorithm>
+#include <cassert>
+#include <cstring>
 #include <memory>
 
 VoxelRenderSystem::VoxelRenderSystem(VvbDevice& device, VkRenderPass renderPass, VkDescriptorSetLayout descriptorSetLayout)
 	: device(device)
 {
-	chunk = std::make_unique<VvbMesh>(device, world.chunks[0]);
+	world.setTaskScheduler(&taskScheduler);
+
+	// bound the time the world stages take when many chunks come in at once (first load, camera jump)
+	world.setStageBudget(World::Stage::load, { 0, 2.0f });
+	world.setStageBudget(World::Stage::setup, { 0, 2.0f });
+	world.setStageBudget(World::Stage::rebuild, { 0, 1.0f });
+	quadIndexBuffer = std::make_unique<VvbQuadIndexBuffer>(device, ChunkMesher::getMaxQuadCount());
+	chunkBuffer = std::make_unique<VvbChunkBuffer>(device, sizeof(PackedVertex));
 	createPipelineLayout(descriptorSetLayout);
 	createPipelines(renderPass);
 }
@@ -20,31 +30,319 @@ VoxelRenderSystem::~VoxelRenderSystem()
 void VoxelRenderSystem::update(glm::vec3 cameraPos, glm::vec3 cameraView)
 {
 	world.update(.1f, cameraPos, cameraView);
+	updateChunkMeshes();
+	updateWorldLoadTime();
+}
+
+void VoxelRenderSystem::setMesherType(ChunkMesher::Type type)
+{
+	if (type == mesherType)
+		return;
+
+	mesherType = type;
+
+	// meshes of the old type still on the workers are thrown away
+	asyncMesher.wait();
+	meshResults.clear();
+	asyncMesher.collect(meshResults);
+
+	// the old meshes may still be used by a frame in flight
+	vkDeviceWaitIdle(device.getDevice());
+	for (RetiredRange& retired : retiredRanges)
+		chunkBuffer->free(retired.range);
+	retiredRanges.clear();
+	for (auto& chunkMesh : chunkMeshes)
+	{
+		chunkBuffer->free(chunkMesh.second.range);
+		chunkBuffer->free(chunkMesh.second.pendingRange);
+	}
+	chunkMeshes.clear();
+	device.getUploadQueue().update();
+	updateChunkMeshes();
+}
+
+void VoxelRenderSystem::updateChunkMeshes()
+{
+	VvbUploadQueue& uploadQueue = device.getUploadQueue();
+
+	updateCount++;
+	uploadQueue.update();
+	releaseRetiredRanges();
+
+	// a mesh lives as long as its chunk is loaded and has something to render
+	// a new mesh is drawn in place of the old one as soon as its upload is done
+	for (auto it = chunkMeshes.begin(); it != chunkMeshes.end();)
+	{
+		ChunkMesh& chunkMesh = it->second;
+		const Chunk* chunk = world.getChunk(it->first);
+		// or destroyed and created again at the same coordinate since the last update
+		if (chunk == nullptr || !chunk->isLoaded || !chunk->shouldRender || chunk->firstRevision != chunkMesh.firstRevision)
+		{
+			retireRange(chunkMesh.range);
+			retireRange(chunkMesh.pendingRange, chunkMesh.uploadTicket);
+			it = chunkMeshes.erase(it);
+			continue;
+		}
+
+		if (chunkMesh.pendingRange.isValid() && uploadQueue.isComplete(chunkMesh.uploadTicket))
+		{
+			retireRange(chunkMesh.range);
+			chunkMesh.range = chunkMesh.pendingRange;
+			chunkMesh.sections = chunkMesh.pendingSections;
+			chunkMesh.pendingRange = VvbChunkBuffer::Range();
+		}
+		++it;
+	}
+
+	// upload the meshes finished by the workers since the last update
+	meshResults.clear();
+	asyncMesher.collect(meshResults);
+
+	for (AsyncChunkMesher::Result& result : meshResults)
+	{
+		// the chunk was unloaded while it was meshed
+		auto it = chunkMeshes.find(result.coord);
+		if (it == chunkMeshes.end())
+			continue;
+
+		// meshed for a chunk destroyed since, another one took its coordinate
+		ChunkMesh& chunkMesh = it->second;
+		if (result.revision < chunkMesh.firstRevision)
+			continue;
+
+		if (chunkMesh.isPending && result.revision == chunkMesh.submittedRevision)
+			chunkMesh.isPending = false;
+
+		// an older job finishing after a newer one
+		if (chunkMesh.hasMesh() && result.revision <= chunkMesh.revision)
+			continue;
+
+		const ChunkMeshData& meshData = result.meshData;
+		if (meshData.sectionMask == Chunk::AllSections)
+		{
+			retireRange(chunkMesh.pendingRange, chunkMesh.uploadTicket);
+			uploadChunkMesh(chunkMesh, meshData);
+		}
+		else if (!chunkMesh.hasMesh() || chunkMesh.isEmpty || !patchChunkMesh(chunkMesh, meshData))
+		{
+			// a section outgrew its range, or there is no mesh to patch yet :
+			// the whole chunk is meshed again with new ranges
+			chunkMesh.staleSections = Chunk::AllSections;
+			continue;
+		}
+
+		chunkMesh.staleSections &= ~meshData.sectionMask;
+		chunkMesh.revision = result.revision;
+	}
+
+	// chunks without a mesh or whose voxels changed since are sent to the workers, once per revision
+	for (ChunkHandle handle : world.renderList)
+	{
+		Chunk& chunk = world.chunks[handle];
+		auto inserted = chunkMeshes.try_emplace(chunk.coord);
+		ChunkMesh& chunkMesh = inserted.first->second;
+		if (inserted.second)
+			chunkMesh.firstRevision = chunk.firstRevision;
+
+		bool isUpToDate = chunkMesh.hasMesh() && chunkMesh.revision == chunk.revision;
+		bool isInFlight = chunkMesh.isPending && chunkMesh.submittedRevision == chunk.revision;
+		if (isUpToDate || isInFlight)
+			continue;
+
+		// every revision bump marks the sections it touched, without a mesh to patch all of them are meshed
+		chunkMesh.staleSections |= chunk.takeDirtySections();
+		uint64_t sectionMask = chunkMesh.range.isValid() && !chunkMesh.pendingRange.isValid() ? chunkMesh.staleSections : Chunk::AllSections;
+		if (sectionMask == 0)
+			sectionMask = Chunk::AllSections;
+
+		asyncMesher.submit(mesherType, world, chunk.coord, VertexFormat::Packed, sectionMask);
+		chunkMesh.submittedRevision = chunk.revision;
+		chunkMesh.isPending = true;
+	}
+
+	// every upload of this update in one transfer submission
+	uploadQueue.submit();
+}
+
+void VoxelRenderSystem::updateWorldLoadTime()
+{
+	if (isWorldLoaded() || world.renderList.empty())
+		return;
+
+	if (world.getStageStats(World::Stage::load).deferredCount > 0 || world.getStageStats(World::Stage::setup).deferredCount > 0)
+		return;
+
+	for (ChunkHandle handle : world.renderList)
+	{
+		auto it = chunkMeshes.find(world.chunks[handle].coord);
+		if (it == chunkMeshes.end() || it->second.isPending || !it->second.hasMesh() || it->second.pendingRange.isValid())
+			return;
+	}
+
+	worldLoadMilliseconds = std::chrono::duration<float, std::chrono::milliseconds::period>(std::chrono::steady_clock::now() - createTime).count();
+}
+
+// the ranges are a quarter larger than the section, and never less than a single voxel of faces,
+// so that most edits are patched in place
+static uint32_t getSectionCapacity(uint32_t vertexCount)
+{
+	uint32_t capacity = vertexCount + std::max(vertexCount / 4, 6u * 4u);
+	return (capacity + 3) & ~3u;
+}
+
+void VoxelRenderSystem::uploadChunkMesh(ChunkMesh& chunkMesh, const ChunkMeshData& meshData)
+{
+	const uint32_t vertexSize = meshData.getVertexSize();
+	assert(vertexSize == chunkBuffer->getVertexSize() && "chunk meshes are packed vertices");
+
+	// a buried or empty chunk, the sections would only be padding
+	chunkMesh.isEmpty = meshData.empty();
+	if (chunkMesh.isEmpty)
+	{
+		retireRange(chunkMesh.range);
+		chunkMesh.vertices.clear();
+		return;
+	}
+
+	uint32_t vertexCount = 0;
+	for (int section = 0; section < Chunk::SectionCount; section++)
+	{
+		chunkMesh.pendingSections[section] = { vertexCount, getSectionCapacity(meshData.sectionVertexCounts[section]) };
+		vertexCount += chunkMesh.pendingSections[section].vertexCapacity;
+	}
+
+	chunkMesh.vertices.assign(vertexCount * vertexSize, 0);
+	const uint8_t* source = static_cast<const uint8_t*>(meshData.getVertexData());
+	for (int section = 0; section < Chunk::SectionCount; section++)
+	{
+		size_t size = meshData.sectionVertexCounts[section] * vertexSize;
+		if (size > 0)
+			std::memcpy(&chunkMesh.vertices[chunkMesh.pendingSections[section].firstVertex * vertexSize], source, size);
+		source += size;
+	}
+
+	uploadPendingRange(chunkMesh);
+}
+
+void VoxelRenderSystem::uploadPendingRange(ChunkMesh& chunkMesh)
+{
+	uint32_t vertexCount = static_cast<uint32_t>(chunkMesh.vertices.size() / chunkBuffer->getVertexSize());
+
+	chunkMesh.pendingRange = chunkBuffer->allocate(vertexCount);
+	chunkMesh.uploadTicket = device.getUploadQueue().getNextTicket();
+	chunkBuffer->writeVertices(chunkMesh.pendingRange, chunkMesh.vertices.data(), 0, vertexCount);
+}
+
+bool VoxelRenderSystem::patchChunkMesh(ChunkMesh& chunkMesh, const ChunkMeshData& meshData)
+{
+	// on top of a patch or a mesh still uploading, its layout is the latest one
+	if (!chunkMesh.pendingRange.isValid())
+		chunkMesh.pendingSections = chunkMesh.sections;
+
+	for (int section = 0; section < Chunk::SectionCount; section++)
+	{
+		if ((meshData.sectionMask & (1ull << section)) && meshData.sectionVertexCounts[section] > chunkMesh.pendingSections[section].vertexCapacity)
+			return false;
+	}
+
+	// the range drawn is owned by the graphics queue and read by the frames in flight, the transfer queue
+	// only ever writes a new one : the whole chunk goes out again but only the sections of the patch were meshed
+	const uint32_t vertexSize = meshData.getVertexSize();
+	const uint8_t* source = static_cast<const uint8_t*>(meshData.getVertexData());
+	for (int section = 0; section < Chunk::SectionCount; section++)
+	{
+		if ((meshData.sectionMask & (1ull << section)) == 0)
+			continue;
+
+		const SectionRange& range = chunkMesh.pendingSections[section];
+		uint8_t* destination = &chunkMesh.vertices[range.firstVertex * vertexSize];
+		size_t size = meshData.sectionVertexCounts[section] * vertexSize;
+		if (size > 0)
+			std::memcpy(destination, source, size);
+		std::memset(destination + size, 0, range.vertexCapacity * vertexSize - size);
+		source += size;
+	}
+
+	retireRange(chunkMesh.pendingRange, chunkMesh.uploadTicket);
+	uploadPendingRange(chunkMesh);
+	return true;
+}
+
+void VoxelRenderSystem::retireRange(VvbChunkBuffer::Range& range, uint64_t uploadTicket)
+{
+	if (!range.isValid())
+		return;
+
+	retiredRanges.push_back({ updateCount, uploadTicket, range });
+	range = VvbChunkBuffer::Range();
+}
+
+void VoxelRenderSystem::releaseRetiredRanges()
+{
+	const VvbUploadQueue& uploadQueue = device.getUploadQueue();
+	auto it = std::remove_if(retiredRanges.begin(), retiredRanges.end(),
+		[&](RetiredRange& retired) {
+			if (retired.updateCount + device.MAX_FRAMES_IN_FLIGHT > updateCount || !uploadQueue.isComplete(retired.uploadTicket))
+				return false;
+			chunkBuffer->free(retired.range);
+			return true;
+		});
+	retiredRanges.erase(it, retiredRanges.end());
 }
 
 void VoxelRenderSystem::render(VkCommandBuffer commandBuffer, VkDescriptorSet descriptorSet)
 {
-	for (int chunkIndex = 0; chunkIndex < world.renderList.size(); chunkIndex++)
+	collectChunkDraws();
+
+	// every chunk mesh draws with the same indices, bound once for the whole frame
+	quadIndexBuffer->bind(commandBuffer);
+
+	voxelPipeline->bind(commandBuffer);
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSet, 0, nullptr);
+	drawChunks(commandBuffer);
+
+	outlinePipeline->bind(commandBuffer);
+	drawChunks(commandBuffer);
+}
+
+void VoxelRenderSystem::collectChunkDraws()
+{
+	chunkDraws.clear();
+	for (ChunkHandle handle : world.renderList)
 	{
-		glm::vec3 chunkPosition(chunkIndex % World::WorldSize,
-							   (chunkIndex / World::WorldSize) % World::WorldSize,
-							   (chunkIndex / (World::WorldSize * World::WorldSize)) % World::WorldSize);
+		const Chunk& chunk = world.chunks[handle];
+
+		// not meshed yet
+		auto it = chunkMeshes.find(chunk.coord);
+		if (it == chunkMeshes.end() || !it->second.range.isValid())
+			continue;
+
+		chunkDraws.push_back({ chunk.coord, it->second.range });
+	}
+
+	// a bind per page, there is only one unless the first one filled up
+	if (chunkBuffer->getPageCount() > 1)
+		std::stable_sort(chunkDraws.begin(), chunkDraws.end(), [](const ChunkDraw& a, const ChunkDraw& b) { return a.range.page < b.range.page; });
+}
+
+void VoxelRenderSystem::drawChunks(VkCommandBuffer commandBuffer)
+{
+	uint32_t boundPage = VvbChunkBuffer::NullPage;
+	for (const ChunkDraw& chunkDraw : chunkDraws)
+	{
+		if (chunkDraw.range.page != boundPage)
+		{
+			boundPage = chunkDraw.range.page;
+			chunkBuffer->bind(commandBuffer, boundPage);
+		}
 
 		PushConstants pushConstants{};
 		pushConstants.data = glm::mat4(1.0f);
-		pushConstants.transform_matrix = glm::translate(glm::mat4(1.0f), chunkPosition * glm::vec3(Chunk::ChunkSize));
-
-		voxelPipeline->bind(commandBuffer);
-		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSet, 0, nullptr);
+		pushConstants.transform_matrix = glm::translate(glm::mat4(1.0f), glm::vec3(chunkDraw.coord * Chunk::ChunkSize));
 
 		vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(PushConstants), &pushConstants);
 
-		chunk->bind(commandBuffer);
-		chunk->draw(commandBuffer);
-
-		outlinePipeline->bind(commandBuffer);
-		chunk->bind(commandBuffer);
-		chunk->draw(commandBuffer);
+		chunkBuffer->draw(commandBuffer, chunkDraw.range);
 	}
 }
 
@@ -73,6 +371,7 @@ void VoxelRenderSystem::render(VkCommandBuffer commandBuffer, VkDescriptorSet de
 
 void VoxelRenderSystem::createPipelines(VkRenderPass renderPass)
 {
-	voxelPipeline = std::make_unique<VvbPipeline>(device, pipelineLayout, renderPass, "shaders/voxel.vert.spv", "shaders/voxel.frag.spv");
-	outlinePipeline = std::make_unique<VvbPipeline>(device, pipelineLayout, renderPass, "shaders/outline.vert.spv", "shaders/outline.frag.spv", Primitive::LineList);
+	// chunk meshes use the 8 byte packed vertex, decoded in the vertex shaders
+	voxelPipeline = std::make_unique<VvbPipeline>(device, pipelineLayout, renderPass, "shaders/voxel.vert.spv", "shaders/voxel.frag.spv", Primitive::TriangleList, VertexFormat::Packed);
+	outlinePipeline = std::make_unique<VvbPipeline>(device, pipelineLayout, renderPass, "shaders/outline.vert.spv", "shaders/outline.frag.spv", Primitive::LineList, VertexFormat::Packed);
 }
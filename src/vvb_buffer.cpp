@@ -33,25 +33,26 @@ VvbBuffer::VvbBuffer(VvbDevice& vvbDevice, VkDeviceSize instanceSize, uint32_t i
 VvbBuffer::~VvbBuffer()
 {
 	unmap();
-	vkDestroyBuffer(vvbDevice.getDevice(), buffer, nullptr);
-	vkFreeMemory(vvbDevice.getDevice(), memory, nullptr);
+	vvbDevice.destroyBuffer(buffer, memory);
 }
 
-VkResult VvbBuffer::map(VkDeviceSize size, VkDeviceSize offset)
+// host visible blocks stay mapped for their whole life, mapping the buffer is only an offset in them
+// so the whole buffer from offset is mapped
+VkResult VvbBuffer::map(VkDeviceSize offset)
 {
-	return vkMapMemory(vvbDevice.getDevice(), memory, offset, size, 0, &mapped);
+	if (memory.mapped == nullptr)
+		return VK_ERROR_MEMORY_MAP_FAILED;
+
+	mapped = static_cast<char*>(memory.mapped) + offset;
+	return VK_SUCCESS;
 }
 
 void VvbBuffer::unmap()
 {
-	if (mapped)
-	{
-		vkUnmapMemory(vvbDevice.getDevice(), memory);
-		mapped = nullptr;
-	}
+	mapped = nullptr;
 }
 
-void VvbBuffer::write(void* data, VkDeviceSize size, VkDeviceSize offset)
+void VvbBuffer::write(const void* data, VkDeviceSize size, VkDeviceSize offset)
 {
 	assert(mapped && "cannot write on unmap memory");
 
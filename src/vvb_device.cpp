@@ -2,6 +2,7 @@
 #include "vvb_device.hpp"
 
 // std
+#include <cstring>
 #include <stdexcept>
 #include <map>
 #include <set>
@@ -13,14 +14,26 @@ VvbDevice::VvbDevice(VvbWindow& vvbWindow, VvbInstance& vvbInstance)
 	createSurface();
 	pickPhysicalDevice();
 	createDevice();
+	memoryAllocator = std::make_unique<VvbMemoryAllocator>(device, physicalDevice);
+	stagingBuffer = std::make_unique<VvbStagingBuffer>(*this, MAX_FRAMES_IN_FLIGHT);
 	createCommandPools();
+	uploadQueue = std::make_unique<VvbUploadQueue>(*this, *stagingBuffer);
 }
 
 VvbDevice::~VvbDevice()
 {
+	// their command buffers come from the pools
+	uploadQueue.reset();
+	destroySingleTimeCommands(graphicsCommands);
+	destroySingleTimeCommands(transferCommands);
+
 	vkDestroyCommandPool(device, graphicsCommandPool, nullptr);
 	vkDestroyCommandPool(device, transferCommandPool, nullptr);
 
+	// the buffers are all destroyed by now, their blocks go back to the device
+	stagingBuffer.reset();
+	memoryAllocator.reset();
+
 	vkDestroyDevice(device, nullptr);
 
 	vkDestroySurfaceKHR(vvbInstance.getInstance(), surface, nullptr);
@@ -308,30 +321,81 @@ void VvbDevice::createCommandPools()
 
 	if (vkCreateCommandPool(device, &poolInfo, nullptr, &transferCommandPool) != VK_SUCCESS)
 		throw std::runtime_error("failed to create command pool!");
+
+	createSingleTimeCommands(graphicsCommands, graphicsCommandPool, graphicsQueue);
+	createSingleTimeCommands(transferCommands, transferCommandPool, transferQueue);
 }
 
-void VvbDevice::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, VkDeviceMemory& bufferMemory)
+void VvbDevice::createSingleTimeCommands(SingleTimeCommands& commands, VkCommandPool commandPool, VkQueue queue)
 {
-	// use the same queue family for transfer and graphics
-	std::vector<uint32_t> bufferCreationIndices = { indices.graphicsFamily.value() };
-	VkSharingMode sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	commands.commandPool = commandPool;
+	commands.queue = queue;
 
-	// use different queues family for transfer and graphics
-	if(indices.isGraphicsTransferQueueConcurent())
-	{
-		bufferCreationIndices.push_back(indices.transferFamily.value());
-		sharingMode = VK_SHARING_MODE_CONCURRENT;
-	}
+	VkCommandBufferAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	allocInfo.pNext = VK_NULL_HANDLE; // optional
+	allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	allocInfo.commandPool = commandPool;
+	allocInfo.commandBufferCount = 1;
+
+	if (vkAllocateCommandBuffers(device, &allocInfo, &commands.commandBuffer) != VK_SUCCESS)
+		throw std::runtime_error("failed to allocate command buffer!");
+
+	VkFenceCreateInfo fenceInfo{};
+	fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+	fenceInfo.pNext = VK_NULL_HANDLE; // optional
+	fenceInfo.flags = 0; // optional
+
+	if (vkCreateFence(device, &fenceInfo, nullptr, &commands.fence) != VK_SUCCESS)
+		throw std::runtime_error("failed to create fence!");
+}
 
+void VvbDevice::destroySingleTimeCommands(SingleTimeCommands& commands)
+{
+	vkFreeCommandBuffers(device, commands.commandPool, 1, &commands.commandBuffer);
+	vkDestroyFence(device, commands.fence, nullptr);
+}
+
+VkCommandBuffer VvbDevice::beginSingleTimeCommands(SingleTimeCommands& commands)
+{
+	VkCommandBufferBeginInfo beginInfo{};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.pNext = VK_NULL_HANDLE; // optional
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	beginInfo.pInheritanceInfo = VK_NULL_HANDLE; // optional
+
+	// the pools reset their command buffers when they begin
+	vkBeginCommandBuffer(commands.commandBuffer, &beginInfo);
+	return commands.commandBuffer;
+}
+
+void VvbDevice::endSingleTimeCommands(SingleTimeCommands& commands)
+{
+	vkEndCommandBuffer(commands.commandBuffer);
+
+	VkSubmitInfo submitInfo{};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &commands.commandBuffer;
+
+	vkResetFences(device, 1, &commands.fence);
+	if (vkQueueSubmit(commands.queue, 1, &submitInfo, commands.fence) != VK_SUCCESS)
+		throw std::runtime_error("failed to submit single time commands!");
+	vkWaitForFences(device, 1, &commands.fence, VK_TRUE, UINT64_MAX);
+}
+
+void VvbDevice::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, VvbMemoryAllocator::Allocation& bufferMemory)
+{
 	VkBufferCreateInfo bufferInfo{};
 	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
 	bufferInfo.pNext = nullptr; // optional
 	bufferInfo.flags = 0; // optional
 	bufferInfo.size = size;
 	bufferInfo.usage = usage;
-	bufferInfo.sharingMode = sharingMode; 
-	bufferInfo.queueFamilyIndexCount = static_cast<uint32_t>(bufferCreationIndices.size());
-	bufferInfo.pQueueFamilyIndices = bufferCreationIndices.data();
+	// owned by one queue family at a time, the upload queue hands the written ranges from transfer to graphics
+	bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	bufferInfo.queueFamilyIndexCount = 0; // optional
+	bufferInfo.pQueueFamilyIndices = nullptr; // optional
 
 	// create buffer
 	if (vkCreateBuffer(device, &bufferInfo, nullptr, &buffer) != VK_SUCCESS)
@@ -341,79 +405,59 @@ void VvbDevice::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemo
 	VkMemoryRequirements memRequirements;
 	vkGetBufferMemoryRequirements(device, buffer, &memRequirements);
 
-	// allocate memory
-	VkMemoryAllocateInfo allocInfo{};
-	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-	allocInfo.pNext = nullptr; // optional
-	allocInfo.allocationSize = memRequirements.size;
-	allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
-
-	if (vkAllocateMemory(device, &allocInfo, nullptr, &bufferMemory) != VK_SUCCESS)
-		throw std::runtime_error("failed to allocate vertex buffer memory!");
+	// sub-allocate memory, the range starts on memRequirements.alignment
+	uint32_t memoryType = findMemoryType(memRequirements.memoryTypeBits, properties);
+	bufferMemory = memoryAllocator->allocate(memRequirements, memoryType);
 
 	// bind memory to the buffer
-	vkBindBufferMemory(device, buffer, bufferMemory, 0);
+	vkBindBufferMemory(device, buffer, bufferMemory.memory, bufferMemory.offset);
 }
 
-void VvbDevice::copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size)
+void VvbDevice::destroyBuffer(VkBuffer buffer, VvbMemoryAllocator::Allocation& bufferMemory)
 {
-	VkCommandBufferAllocateInfo allocInfo{};
-	allocInfo.pNext = VK_NULL_HANDLE; // optional
-	allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-	allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-	allocInfo.commandPool = transferCommandPool;
-	allocInfo.commandBufferCount = 1;
-
-	VkCommandBuffer commandBuffer;
-	vkAllocateCommandBuffers(device, &allocInfo, &commandBuffer);
-
-	VkCommandBufferBeginInfo beginInfo{};
-	beginInfo.pNext = VK_NULL_HANDLE; // optional
-	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
-	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-	beginInfo.pInheritanceInfo = VK_NULL_HANDLE; // optional
-
-	vkBeginCommandBuffer(commandBuffer, &beginInfo);
+	vkDestroyBuffer(device, buffer, nullptr);
+	memoryAllocator->free(bufferMemory);
+}
 
-	VkBufferCopy copyRegion{};
-	copyRegion.srcOffset = 0; // optional
-	copyRegion.dstOffset = 0; // optional
-	copyRegion.size = size;
-	vkCmdCopyBuffer(commandBuffer, srcBuffer, dstBuffer, 1, &copyRegion);
+void* VvbDevice::createTemporaryStagingBuffer(VkDeviceSize size, VkBuffer& buffer, VvbMemoryAllocator::Allocation& bufferMemory)
+{
+	createBuffer(size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, buffer, bufferMemory);
+	return bufferMemory.mapped;
+}
 
-	vkEndCommandBuffer(commandBuffer);
+void VvbDevice::beginFrame(uint32_t frameIndex)
+{
+	uploadQueue->waitForFrame(frameIndex);
+	stagingBuffer->beginFrame(frameIndex);
+}
 
-	VkSubmitInfo submitInfo{};
-	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-	submitInfo.commandBufferCount = 1;
-	submitInfo.pCommandBuffers = &commandBuffer;
+void VvbDevice::uploadToBuffer(const void* data, VkDeviceSize size, VkBuffer dstBuffer, VkDeviceSize dstOffset)
+{
+	// through the upload queue for the ownership transfer, sent with whatever it holds
+	uploadQueue->upload(data, size, dstBuffer, dstOffset);
+	uploadQueue->wait(uploadQueue->submit());
+}
 
-	vkQueueSubmit(transferQueue, 1, &submitInfo, VK_NULL_HANDLE);
-	vkQueueWaitIdle(transferQueue);
+void VvbDevice::uploadToImage(const void* data, VkDeviceSize size, VkImage image, uint32_t width, uint32_t height)
+{
+	VvbStagingBuffer::Region region = stagingBuffer->allocate(size);
+	if (region.isValid())
+	{
+		std::memcpy(region.mapped, data, size);
+		copyBufferToImage(region.buffer, image, width, height, region.offset);
+		return;
+	}
 
-	vkFreeCommandBuffers(device, transferCommandPool, 1, &commandBuffer);
+	VkBuffer buffer;
+	VvbMemoryAllocator::Allocation bufferMemory;
+	std::memcpy(createTemporaryStagingBuffer(size, buffer, bufferMemory), data, size);
+	copyBufferToImage(buffer, image, width, height);
+	destroyBuffer(buffer, bufferMemory);
 }
 
-
 void VvbDevice::transitionImageLayout(VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout, uint32_t mipLevels)
 {
-	VkCommandBufferAllocateInfo allocInfo{};
-	allocInfo.pNext = VK_NULL_HANDLE; // optional
-	allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-	allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-	allocInfo.commandPool = graphicsCommandPool;
-	allocInfo.commandBufferCount = 1;
-
-	VkCommandBuffer commandBuffer;
-	vkAllocateCommandBuffers(device, &allocInfo, &commandBuffer);
-
-	VkCommandBufferBeginInfo beginInfo{};
-	beginInfo.pNext = VK_NULL_HANDLE; // optional
-	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
-	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-	beginInfo.pInheritanceInfo = VK_NULL_HANDLE; // optional
-
-	vkBeginCommandBuffer(commandBuffer, &beginInfo);
+	VkCommandBuffer commandBuffer = beginSingleTimeCommands(graphicsCommands);
 
 	VkPipelineStageFlags sourceSTAGE;
 	VkPipelineStageFlags destinationSTAGE;
@@ -475,41 +519,15 @@ void VvbDevice::transitionImageLayout(VkImage image, VkFormat format, VkImageLay
 	);
 
 
-	vkEndCommandBuffer(commandBuffer);
-
-	VkSubmitInfo submitInfo{};
-	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-	submitInfo.commandBufferCount = 1;
-	submitInfo.pCommandBuffers = &commandBuffer;
-
-	vkQueueSubmit(graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE);
-	vkQueueWaitIdle(graphicsQueue);
-
-	vkFreeCommandBuffers(device, graphicsCommandPool, 1, &commandBuffer);
+	endSingleTimeCommands(graphicsCommands);
 }
 
-void VvbDevice::copyBufferToImage(VkBuffer buffer, VkImage image, uint32_t width, uint32_t height)
+void VvbDevice::copyBufferToImage(VkBuffer buffer, VkImage image, uint32_t width, uint32_t height, VkDeviceSize bufferOffset)
 {
-	VkCommandBufferAllocateInfo allocInfo{};
-	allocInfo.pNext = VK_NULL_HANDLE; // optional
-	allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-	allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-	allocInfo.commandPool = transferCommandPool;
-	allocInfo.commandBufferCount = 1;
-
-	VkCommandBuffer commandBuffer;
-	vkAllocateCommandBuffers(device, &allocInfo, &commandBuffer);
-
-	VkCommandBufferBeginInfo beginInfo{};
-	beginInfo.pNext = VK_NULL_HANDLE; // optional
-	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
-	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-	beginInfo.pInheritanceInfo = VK_NULL_HANDLE; // optional
-
-	vkBeginCommandBuffer(commandBuffer, &beginInfo);
+	VkCommandBuffer commandBuffer = beginSingleTimeCommands(transferCommands);
 
 	VkBufferImageCopy region{};
-	region.bufferOffset = 0;
+	region.bufferOffset = bufferOffset;
 	region.bufferRowLength = 0;
 	region.bufferImageHeight = 0;
 
@@ -534,17 +552,7 @@ void VvbDevice::copyBufferToImage(VkBuffer buffer, VkImage image, uint32_t width
 		&region
 	);
 
-	vkEndCommandBuffer(commandBuffer);
-
-	VkSubmitInfo submitInfo{};
-	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-	submitInfo.commandBufferCount = 1;
-	submitInfo.pCommandBuffers = &commandBuffer;
-
-	vkQueueSubmit(transferQueue, 1, &submitInfo, VK_NULL_HANDLE);
-	vkQueueWaitIdle(transferQueue);
-
-	vkFreeCommandBuffers(device, transferCommandPool, 1, &commandBuffer);
+	endSingleTimeCommands(transferCommands);
 }
 
 bool VvbDevice::hasStencilComponent(VkFormat format)
@@ -568,23 +576,7 @@ void VvbDevice::generateMipmaps(VkImage image, VkFormat imageFormat, uint32_t wi
 	*/
 
 	// begin single time command
-	VkCommandBufferAllocateInfo allocInfo{};
-	allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-	allocInfo.pNext = VK_NULL_HANDLE; // optional
-	allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-	allocInfo.commandPool = graphicsCommandPool;
-	allocInfo.commandBufferCount = 1;
-
-	VkCommandBuffer commandBuffer;
-	vkAllocateCommandBuffers(device, &allocInfo, &commandBuffer);
-
-	VkCommandBufferBeginInfo beginInfo{};
-	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-	beginInfo.pNext = VK_NULL_HANDLE; // optional
-	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
-	beginInfo.pInheritanceInfo = VK_NULL_HANDLE; // optional
-
-	vkBeginCommandBuffer(commandBuffer, &beginInfo);
+	VkCommandBuffer commandBuffer = beginSingleTimeCommands(graphicsCommands);
 
 
 	VkImageMemoryBarrier barrier{};
@@ -662,17 +654,7 @@ void VvbDevice::generateMipmaps(VkImage image, VkFormat imageFormat, uint32_t wi
 		1, &barrier);
 
 	// end command
-	vkEndCommandBuffer(commandBuffer);
-
-	VkSubmitInfo submitInfo{};
-	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-	submitInfo.commandBufferCount = 1;
-	submitInfo.pCommandBuffers = &commandBuffer;
-
-	vkQueueSubmit(graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE);
-	vkQueueWaitIdle(graphicsQueue);
-
-	vkFreeCommandBuffers(device, graphicsCommandPool, 1, &commandBuffer);
+	endSingleTimeCommands(graphicsCommands);
 }
 
 void VvbDevice::createImage(uint32_t width, uint32_t height, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage& image, VkDeviceMemory& imageMemory, uint32_t mipLevels, VkSampleCountFlagBits numSamples)
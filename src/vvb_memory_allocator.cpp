@@ -0,0 +1,192 @@
+// vulkan base
+#include "vvb_memory_allocator.hpp"
+
+// std
+#include <cassert>
+#include <stdexcept>
+
+VvbMemoryAllocator::VvbMemoryAllocator(VkDevice device, VkPhysicalDevice physicalDevice, VkDeviceSize blockSize)
+	: device(device), blockSize(blockSize)
+{
+	vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+	blocks.resize(memoryProperties.memoryTypeCount);
+}
+
+VvbMemoryAllocator::~VvbMemoryAllocator()
+{
+	for (uint32_t memoryType = 0; memoryType < blocks.size(); memoryType++)
+	{
+		for (uint32_t blockIndex = 0; blockIndex < blocks[memoryType].size(); blockIndex++)
+		{
+			if (blocks[memoryType][blockIndex])
+			{
+				// a dedicated block is destroyed with its allocation
+				assert(!blocks[memoryType][blockIndex]->isDedicated && blocks[memoryType][blockIndex]->ranges.empty() && "device memory still in use");
+				destroyBlock(memoryType, blockIndex);
+			}
+		}
+	}
+}
+
+VvbMemoryAllocator::Allocation VvbMemoryAllocator::allocate(const VkMemoryRequirements& requirements, uint32_t memoryType)
+{
+	assert(memoryType < blocks.size() && "unknown memory type");
+
+	Allocation allocation;
+	allocation.memoryType = memoryType;
+
+	// too large to share a block : a block of its own, freed with it
+	if (requirements.size > blockSize / 2)
+	{
+		// vkAllocateMemory aligns the block for any resource, offset 0 fits whatever the alignment
+		allocation.blockIndex = createBlock(memoryType, requirements.size, true);
+		Block& block = *blocks[memoryType][allocation.blockIndex];
+		block.dedicatedSize = requirements.size;
+
+		allocation.memory = block.memory;
+		allocation.offset = 0;
+		allocation.size = requirements.size;
+		allocation.mapped = block.mapped;
+		return allocation;
+	}
+
+	std::vector<std::unique_ptr<Block>>& typeBlocks = blocks[memoryType];
+	uint32_t blockIndex = 0;
+	for (; blockIndex < typeBlocks.size(); blockIndex++)
+	{
+		if (typeBlocks[blockIndex] && !typeBlocks[blockIndex]->isDedicated
+			&& typeBlocks[blockIndex]->ranges.allocate(requirements.size, requirements.alignment, allocation.range))
+			break;
+	}
+
+	// every block is full : one more
+	if (blockIndex == typeBlocks.size())
+	{
+		blockIndex = createBlock(memoryType, blockSize, false);
+		if (!typeBlocks[blockIndex]->ranges.allocate(requirements.size, requirements.alignment, allocation.range))
+			throw std::runtime_error("failed to sub-allocate device memory!");
+	}
+
+	Block& block = *typeBlocks[blockIndex];
+	allocation.blockIndex = blockIndex;
+	allocation.memory = block.memory;
+	allocation.offset = allocation.range.offset;
+	allocation.size = requirements.size;
+	allocation.mapped = block.mapped ? static_cast<char*>(block.mapped) + allocation.offset : nullptr;
+	return allocation;
+}
+
+void VvbMemoryAllocator::free(Allocation& allocation)
+{
+	if (!allocation.isValid())
+		return;
+
+	std::vector<std::unique_ptr<Block>>& typeBlocks = blocks[allocation.memoryType];
+	Block& block = *typeBlocks[allocation.blockIndex];
+	if (block.isDedicated)
+	{
+		destroyBlock(allocation.memoryType, allocation.blockIndex);
+		allocation = Allocation();
+		return;
+	}
+
+	block.ranges.free(allocation.range);
+
+	// an empty block goes back to the driver, unless it is the last shared block of its type :
+	// that one is kept so that streaming does not allocate and free a block over and over
+	if (block.ranges.empty())
+	{
+		bool isLastShared = true;
+		for (uint32_t blockIndex = 0; blockIndex < typeBlocks.size() && isLastShared; blockIndex++)
+		{
+			if (blockIndex != allocation.blockIndex && typeBlocks[blockIndex] && !typeBlocks[blockIndex]->isDedicated)
+				isLastShared = false;
+		}
+
+		if (!isLastShared)
+			destroyBlock(allocation.memoryType, allocation.blockIndex);
+	}
+
+	allocation = Allocation();
+}
+
+VvbMemoryAllocator::Stats VvbMemoryAllocator::getStats() const
+{
+	Stats stats;
+	VkDeviceSize freeBytes = 0;
+	VkDeviceSize largestFreeBytes = 0;
+
+	for (const std::vector<std::unique_ptr<Block>>& typeBlocks : blocks)
+	{
+		for (const std::unique_ptr<Block>& block : typeBlocks)
+		{
+			if (!block)
+				continue;
+
+			stats.blockCount++;
+			stats.reservedBytes += block->ranges.getSize();
+
+			if (block->isDedicated)
+			{
+				stats.dedicatedBlockCount++;
+				stats.allocationCount++;
+				stats.usedBytes += block->dedicatedSize;
+				continue;
+			}
+
+			stats.allocationCount += block->ranges.getAllocationCount();
+			stats.usedBytes += block->ranges.getUsedSize();
+			freeBytes += block->ranges.getFreeSize();
+			largestFreeBytes += block->ranges.getLargestFreeRange();
+		}
+	}
+
+	stats.fragmentation = freeBytes > 0 ? 1.0f - (float)largestFreeBytes / (float)freeBytes : 0.0f;
+	return stats;
+}
+
+uint32_t VvbMemoryAllocator::createBlock(uint32_t memoryType, VkDeviceSize size, bool isDedicated)
+{
+	// the ranges are multiples of the tlsf granularity, so is the block
+	size = (size + TlsfAllocator::Granularity - 1) & ~(TlsfAllocator::Granularity - 1);
+
+	std::unique_ptr<Block> block = std::make_unique<Block>(size);
+	block->isDedicated = isDedicated;
+
+	VkMemoryAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	allocInfo.pNext = nullptr; // optional
+	allocInfo.allocationSize = size;
+	allocInfo.memoryTypeIndex = memoryType;
+
+	if (vkAllocateMemory(device, &allocInfo, nullptr, &block->memory) != VK_SUCCESS)
+		throw std::runtime_error("failed to allocate device memory block!");
+
+	if (memoryProperties.memoryTypes[memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+	{
+		if (vkMapMemory(device, block->memory, 0, VK_WHOLE_SIZE, 0, &block->mapped) != VK_SUCCESS)
+			throw std::runtime_error("failed to map device memory block!");
+	}
+
+	std::vector<std::unique_ptr<Block>>& typeBlocks = blocks[memoryType];
+	for (uint32_t blockIndex = 0; blockIndex < typeBlocks.size(); blockIndex++)
+	{
+		if (!typeBlocks[blockIndex])
+		{
+			typeBlocks[blockIndex] = std::move(block);
+			return blockIndex;
+		}
+	}
+
+	typeBlocks.push_back(std::move(block));
+	return static_cast<uint32_t>(typeBlocks.size() - 1);
+}
+
+void VvbMemoryAllocator::destroyBlock(uint32_t memoryType, uint32_t blockIndex)
+{
+	std::unique_ptr<Block>& block = blocks[memoryType][blockIndex];
+	if (block->mapped)
+		vkUnmapMemory(device, block->memory);
+	vkFreeMemory(device, block->memory, nullptr);
+	block.reset();
+}
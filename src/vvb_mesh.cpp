@@ -1,5 +1,10 @@
 // vulkan base
 #include "vvb_mesh.hpp"
+#include "mesher/chunk_mesher.hpp"
+
+// std
+#include <algorithm>
+#include <stdexcept>
 
 bool Vertex::operator==(const Vertex& other) const {
     return position == other.position && color == other.color && texCoord == other.texCoord;
@@ -37,207 +42,153 @@ std::array<VkVertexInputAttributeDescription, 3> Vertex::getAttributeDescription
     return attributeDescriptions;
 }
 
-VvbMesh::VvbMesh(VvbDevice& vvbDevice, Chunk chunk)
-    : vvbDevice(vvbDevice)
+VkVertexInputBindingDescription PackedVertex::getBindingDescription()
 {
-    std::vector<Vertex> vertices;
-    std::vector<uint32_t> indices;
-    generateGeometry(chunk, vertices, indices);
+    VkVertexInputBindingDescription bindingDescription{};
+    bindingDescription.binding = 0;
+    bindingDescription.stride = sizeof(PackedVertex);
+    bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
 
-    createVertexBuffer(vertices);
-    createIndexBuffer(indices);
+    return bindingDescription;
 }
 
-VvbMesh::~VvbMesh()
+std::array<VkVertexInputAttributeDescription, 1> PackedVertex::getAttributeDescriptions()
 {
+    std::array<VkVertexInputAttributeDescription, 1> attributeDescriptions{};
+
+    attributeDescriptions[0].binding = 0;
+    attributeDescriptions[0].location = 0;
+    attributeDescriptions[0].format = VK_FORMAT_R32G32_UINT;
+    attributeDescriptions[0].offset = offsetof(PackedVertex, data);
+
+    return attributeDescriptions;
 }
 
-void VvbMesh::generateGeometry(Chunk chunk, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+VvbQuadIndexBuffer::VvbQuadIndexBuffer(VvbDevice& vvbDevice, uint32_t maxQuadCount)
+    : vvbDevice(vvbDevice)
 {
-    for (int voxelIndex = 0; voxelIndex < chunk.voxels.size(); voxelIndex++)
+    quadCount = std::min(maxQuadCount, MaxQuadsPerDraw);
+    assert(quadCount > 0 && "quad index buffer can't be empty");
+
+    std::vector<uint16_t> indices(quadCount * 6);
+    for (uint32_t quad = 0; quad < quadCount; quad++)
     {
-		Voxel voxel = chunk.voxels[voxelIndex];
-		if(voxel.id == 0)
-			continue;
-
-		int x = voxelIndex % Chunk::ChunkSize;
-		int y = (voxelIndex / Chunk::ChunkSize) % Chunk::ChunkSize;
-		int z = (voxelIndex / (Chunk::ChunkSize * Chunk::ChunkSize)) % Chunk::ChunkSize;
-
-		glm::vec3 position = glm::vec3(x, y, z);
-		glm::vec3 color = glm::vec3(1.0f, 1.0f, 1.0f);
-		glm::vec2 texCoord = glm::vec2(0.0f, 0.0f);
-
-        // front
-		vertices.push_back({ position + glm::vec3(0.0f, 0.0f, 1.0f), color, texCoord });
-		vertices.push_back({ position + glm::vec3(1.0f, 0.0f, 1.0f), color, texCoord });
-		vertices.push_back({ position + glm::vec3(1.0f, 1.0f, 1.0f), color, texCoord });
-		vertices.push_back({ position + glm::vec3(0.0f, 1.0f, 1.0f), color, texCoord });
-
-		indices.push_back(vertexCount + 0);
-		indices.push_back(vertexCount + 1);
-		indices.push_back(vertexCount + 2);
-		indices.push_back(vertexCount + 2);
-		indices.push_back(vertexCount + 3);
-		indices.push_back(vertexCount + 0);
-
-		vertexCount += 4;
-		indexCount += 6;
-
-		// back
-        vertices.push_back({ position + glm::vec3(0.0f, 0.0f, 0.0f), color, texCoord });
-        vertices.push_back({ position + glm::vec3(1.0f, 0.0f, 0.0f), color, texCoord });
-        vertices.push_back({ position + glm::vec3(1.0f, 1.0f, 0.0f), color, texCoord });
-        vertices.push_back({ position + glm::vec3(0.0f, 1.0f, 0.0f), color, texCoord });
-
-        indices.push_back(vertexCount + 0);
-	    indices.push_back(vertexCount + 1);
-	    indices.push_back(vertexCount + 2);
-	    indices.push_back(vertexCount + 2);
-	    indices.push_back(vertexCount + 3);
-	    indices.push_back(vertexCount + 0);
-
-	    vertexCount += 4;
-	    indexCount += 6;
-
-		// left
-		vertices.push_back({ position + glm::vec3(0.0f, 0.0f, 0.0f), color, texCoord });
-		vertices.push_back({ position + glm::vec3(0.0f, 0.0f, 1.0f), color, texCoord });
-		vertices.push_back({ position + glm::vec3(0.0f, 1.0f, 1.0f), color, texCoord });
-		vertices.push_back({ position + glm::vec3(0.0f, 1.0f, 0.0f), color, texCoord });
-
-		indices.push_back(vertexCount + 0);
-	    indices.push_back(vertexCount + 1);
-	    indices.push_back(vertexCount + 2);
-	    indices.push_back(vertexCount + 2);
-	    indices.push_back(vertexCount + 3);
-	    indices.push_back(vertexCount + 0);
-
-	    vertexCount += 4;
-	    indexCount += 6;
-
-        
-        // right
-        vertices.push_back({ position + glm::vec3(1.0f, 0.0f, 0.0f), color, texCoord });
-        vertices.push_back({ position + glm::vec3(1.0f, 0.0f, 1.0f), color, texCoord });
-        vertices.push_back({ position + glm::vec3(1.0f, 1.0f, 1.0f), color, texCoord });
-        vertices.push_back({ position + glm::vec3(1.0f, 1.0f, 0.0f), color, texCoord });
-
-        indices.push_back(vertexCount + 0);
-	    indices.push_back(vertexCount + 1);
-	    indices.push_back(vertexCount + 2);
-	    indices.push_back(vertexCount + 2);
-	    indices.push_back(vertexCount + 3);
-	    indices.push_back(vertexCount + 0);
-
-	    vertexCount += 4;
-	    indexCount += 6;
-
-		// top
-		vertices.push_back({ position + glm::vec3(0.0f, 1.0f, 0.0f), color, texCoord });
-		vertices.push_back({ position + glm::vec3(1.0f, 1.0f, 0.0f), color, texCoord });
-		vertices.push_back({ position + glm::vec3(1.0f, 1.0f, 1.0f), color, texCoord });
-		vertices.push_back({ position + glm::vec3(0.0f, 1.0f, 1.0f), color, texCoord });
-
-		indices.push_back(vertexCount + 0);
-	    indices.push_back(vertexCount + 1);
-	    indices.push_back(vertexCount + 2);
-	    indices.push_back(vertexCount + 2);
-	    indices.push_back(vertexCount + 3);
-	    indices.push_back(vertexCount + 0);
-
-	    vertexCount += 4;
-	    indexCount += 6;
-
-        // bottom
-        vertices.push_back({ position + glm::vec3(0.0f, 0.0f, 0.0f), color, texCoord });
-        vertices.push_back({ position + glm::vec3(1.0f, 0.0f, 0.0f), color, texCoord });
-        vertices.push_back({ position + glm::vec3(1.0f, 0.0f, 1.0f), color, texCoord });    
-        vertices.push_back({ position + glm::vec3(0.0f, 0.0f, 1.0f), color, texCoord });
-
-        indices.push_back(vertexCount + 0);
-        indices.push_back(vertexCount + 1);
-        indices.push_back(vertexCount + 2);
-        indices.push_back(vertexCount + 2);
-        indices.push_back(vertexCount + 3);
-        indices.push_back(vertexCount + 0);
-
-        vertexCount += 4;
-        indexCount += 6;
+        uint16_t vertex = static_cast<uint16_t>(quad * 4);
+        indices[quad * 6 + 0] = vertex + 0;
+        indices[quad * 6 + 1] = vertex + 1;
+        indices[quad * 6 + 2] = vertex + 2;
+        indices[quad * 6 + 3] = vertex + 2;
+        indices[quad * 6 + 4] = vertex + 3;
+        indices[quad * 6 + 5] = vertex + 0;
     }
+
+    indexBuffer = std::make_unique<VvbBuffer>(
+        vvbDevice,
+        sizeof(uint16_t),
+        static_cast<uint32_t>(indices.size()),
+        VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
+    );
+
+    vvbDevice.uploadToBuffer(indices.data(), indexBuffer->getSize(), indexBuffer->getBuffer());
 }
 
-void VvbMesh::createVertexBuffer(std::vector<Vertex>& vertices)
+VvbQuadIndexBuffer::~VvbQuadIndexBuffer()
 {
-    VkDeviceSize vertexSize = sizeof(Vertex);
-    VvbBuffer stagingBuffer{
-        vvbDevice,
-        vertexSize,
-        vertexCount,
-        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
-    };
+}
 
-    VkResult res = stagingBuffer.map();
-    stagingBuffer.write(vertices.data());
+void VvbQuadIndexBuffer::bind(VkCommandBuffer commandBuffer)
+{
+    vkCmdBindIndexBuffer(commandBuffer, indexBuffer->getBuffer(), 0, VK_INDEX_TYPE_UINT16);
+}
 
-    vertexBuffer = std::make_unique<VvbBuffer>(
+VvbChunkBuffer::VvbChunkBuffer(VvbDevice& vvbDevice, VkDeviceSize vertexSize, VkDeviceSize pageSize)
+    : vvbDevice(vvbDevice), vertexSize(vertexSize), pageSize(pageSize)
+{
+    assert(vertexSize > 0 && (vertexSize & (vertexSize - 1)) == 0 && "chunk buffer vertices must be a power of two in size");
+    createPage();
+}
+
+VvbChunkBuffer::~VvbChunkBuffer()
+{
+}
+
+void VvbChunkBuffer::createPage()
+{
+    std::unique_ptr<Page> page = std::make_unique<Page>(pageSize);
+    page->vertexBuffer = std::make_unique<VvbBuffer>(
         vvbDevice,
         vertexSize,
-        vertexCount,
+        static_cast<uint32_t>(pageSize / vertexSize),
         VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
         VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
     );
-
-    vvbDevice.copyBuffer(stagingBuffer.getBuffer(), vertexBuffer->getBuffer(), vertexBuffer->getSize());
+    pages.push_back(std::move(page));
 }
 
-
-void VvbMesh::createIndexBuffer(std::vector<uint32_t>& indices)
+VvbChunkBuffer::Range VvbChunkBuffer::allocate(uint32_t vertexCount)
 {
-    if (indexCount == 0)
-        return;
+    assert(vertexCount > 0 && vertexCount % 4 == 0 && "chunk meshes are made of quads");
 
-    hasIndexBuffer = true;
+    VkDeviceSize size = vertexCount * vertexSize;
+    if (size > pageSize)
+        throw std::runtime_error("failed to allocate chunk vertices, larger than a chunk buffer page!");
 
-    VvbBuffer stagingBuffer{
-        vvbDevice,
-        sizeof(uint32_t),
-        indexCount,
-        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
-    };
+    Range range;
+    for (uint32_t page = 0; page < pages.size() && !range.isValid(); page++)
+    {
+        if (pages[page]->ranges.allocate(size, vertexSize, range.allocation))
+            range.page = page;
+    }
 
-    VkResult res = stagingBuffer.map();
-    stagingBuffer.write(indices.data());
+    // every page is full : one more, bound on its own
+    if (!range.isValid())
+    {
+        createPage();
+        range.page = static_cast<uint32_t>(pages.size() - 1);
+        if (!pages[range.page]->ranges.allocate(size, vertexSize, range.allocation))
+            throw std::runtime_error("failed to allocate chunk vertices!");
+    }
 
-    indexBuffer = std::make_unique<VvbBuffer>(
-        vvbDevice,
-        sizeof(uint32_t),
-        indexCount,
-        VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
-        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
-    );
+    range.firstVertex = static_cast<uint32_t>(range.allocation.offset / vertexSize);
+    range.vertexCount = vertexCount;
+    return range;
+}
+
+void VvbChunkBuffer::free(Range& range)
+{
+    if (!range.isValid())
+        return;
+
+    pages[range.page]->ranges.free(range.allocation);
+    range = Range();
+}
+
+void VvbChunkBuffer::writeVertices(const Range& range, const void* vertices, uint32_t firstVertex, uint32_t count)
+{
+    assert(range.isValid() && firstVertex + count <= range.vertexCount && "vertices written past the end of the range");
+    if (count == 0)
+        return;
 
-    vvbDevice.copyBuffer(stagingBuffer.getBuffer(), indexBuffer->getBuffer(), indexBuffer->getSize());
+    VkDeviceSize dstOffset = (range.firstVertex + firstVertex) * vertexSize;
+    vvbDevice.getUploadQueue().upload(vertices, count * vertexSize, pages[range.page]->vertexBuffer->getBuffer(), dstOffset);
 }
 
-void VvbMesh::bind(VkCommandBuffer commandBuffer)
+void VvbChunkBuffer::bind(VkCommandBuffer commandBuffer, uint32_t page)
 {
-    // bind vertex buffer
-    VkBuffer buffers[] = { vertexBuffer->getBuffer() };
+    VkBuffer buffers[] = { pages[page]->vertexBuffer->getBuffer() };
     VkDeviceSize offsets[] = { 0 };
     vkCmdBindVertexBuffers(commandBuffer, 0, 1, buffers, offsets);
-
-    // bind index buffer
-    if (hasIndexBuffer)
-        vkCmdBindIndexBuffer(commandBuffer, indexBuffer->getBuffer(), 0, VK_INDEX_TYPE_UINT32);
 }
 
-void VvbMesh::draw(VkCommandBuffer commandBuffer)
+void VvbChunkBuffer::draw(VkCommandBuffer commandBuffer, const Range& range)
 {
-    if (hasIndexBuffer)
-        vkCmdDrawIndexed(commandBuffer, indexCount, 1, 0, 0, 0);
-    else
-        vkCmdDraw(commandBuffer, vertexCount, 1, 0, 0);
+    // the shared index buffer only goes up to MaxQuadsPerDraw quads, the vertex offset moves
+    // each batch to its own 65536 vertices window in the range of the chunk
+    uint32_t quadCount = range.vertexCount / 4;
+    for (uint32_t firstQuad = 0; firstQuad < quadCount; firstQuad += VvbQuadIndexBuffer::MaxQuadsPerDraw)
+    {
+        uint32_t batchQuadCount = std::min(quadCount - firstQuad, VvbQuadIndexBuffer::MaxQuadsPerDraw);
+        vkCmdDrawIndexed(commandBuffer, batchQuadCount * 6, 1, 0, static_cast<int32_t>(range.firstVertex + firstQuad * 4), 0);
+    }
 }
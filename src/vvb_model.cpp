@@ -45,30 +45,38 @@ std::array<VkVertexInputAttributeDescription, 3> VvbModel::Vertex::getAttributeD
 VvbModel::VvbModel(VvbDevice& vvbDevice, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, const std::string textureFile)
     : vvbDevice(vvbDevice)
 {
-    createVertexBuffer(vertices);
-    createIndexBuffer(indices);
+    VvbUploadBatch uploads(vvbDevice);
+    createVertexBuffer(vertices, uploads);
+    createIndexBuffer(indices, uploads);
+    uploads.submit();
     createTexture(textureFile);
 }
 
 VvbModel::VvbModel(VvbDevice& vvbDevice, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
     : vvbDevice(vvbDevice)
 {
-    createVertexBuffer(vertices);
-    createIndexBuffer(indices);
+    VvbUploadBatch uploads(vvbDevice);
+    createVertexBuffer(vertices, uploads);
+    createIndexBuffer(indices, uploads);
+    uploads.submit();
     texture = std::make_unique<VvbTexture>(vvbDevice);
 }
 
 VvbModel::VvbModel(VvbDevice& vvbDevice, std::vector<Vertex>& vertices)
     : vvbDevice(vvbDevice)
 {
-    createVertexBuffer(vertices);
+    VvbUploadBatch uploads(vvbDevice);
+    createVertexBuffer(vertices, uploads);
+    uploads.submit();
     texture = std::make_unique<VvbTexture>(vvbDevice);
 }
 
 VvbModel::VvbModel(VvbDevice& vvbDevice, const std::string modelFile, const std::string textureFile)
     : vvbDevice(vvbDevice)
 {
-    loadModel(modelFile);
+    VvbUploadBatch uploads(vvbDevice);
+    loadModel(modelFile, uploads);
+    uploads.submit();
     createTexture(textureFile);
 }
 
@@ -76,22 +84,11 @@ VvbModel::~VvbModel()
 {
 }
 
-void VvbModel::createVertexBuffer(std::vector<Vertex>& vertices)
+void VvbModel::createVertexBuffer(std::vector<Vertex>& vertices, VvbUploadBatch& uploads)
 {
     VkDeviceSize vertexSize = sizeof(vertices[0]);
     vertexCount = static_cast<uint32_t>(vertices.size());
 
-    VvbBuffer stvvbingBuffer{
-        vvbDevice,
-        vertexSize,
-        vertexCount,
-        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
-    };
-
-    VkResult res = stvvbingBuffer.map();
-    stvvbingBuffer.write(vertices.data());
-
     vertexBuffer = std::make_unique<VvbBuffer>(
         vvbDevice,
         vertexSize,
@@ -100,10 +97,10 @@ void VvbModel::createVertexBuffer(std::vector<Vertex>& vertices)
         VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
     );
 
-    vvbDevice.copyBuffer(stvvbingBuffer.getBuffer(), vertexBuffer->getBuffer(), vertexBuffer->getSize());
+    uploads.upload(vertices.data(), vertexBuffer->getSize(), vertexBuffer->getBuffer());
 }
 
-void VvbModel::createIndexBuffer(std::vector<uint32_t>& indices)
+void VvbModel::createIndexBuffer(std::vector<uint32_t>& indices, VvbUploadBatch& uploads)
 {
     indexCount = static_cast<uint32_t>(indices.size());
 
@@ -112,17 +109,6 @@ void VvbModel::createIndexBuffer(std::vector<uint32_t>& indices)
 
     hasIndexBuffer = true;
 
-    VvbBuffer stvvbingBuffer{
-        vvbDevice,
-        sizeof(uint32_t),
-        indexCount,
-        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
-    };
-
-    VkResult res = stvvbingBuffer.map();
-    stvvbingBuffer.write(indices.data());
-
     indexBuffer = std::make_unique<VvbBuffer>(
         vvbDevice,
         sizeof(uint32_t),
@@ -131,7 +117,7 @@ void VvbModel::createIndexBuffer(std::vector<uint32_t>& indices)
         VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
     );
 
-    vvbDevice.copyBuffer(stvvbingBuffer.getBuffer(), indexBuffer->getBuffer(), indexBuffer->getSize());
+    uploads.upload(indices.data(), indexBuffer->getSize(), indexBuffer->getBuffer());
 }
 
 void VvbModel::createTexture(const std::string textureFile)
@@ -160,7 +146,7 @@ void VvbModel::draw(VkCommandBuffer commandBuffer)
         vkCmdDraw(commandBuffer, vertexCount, 1, 0, 0);
 }
 
-void VvbModel::loadModel(const std::string modelFile)
+void VvbModel::loadModel(const std::string modelFile, VvbUploadBatch& uploads)
 {
     tinyobj::attrib_t attrib;
     std::vector<tinyobj::shape_t> shapes;
@@ -202,6 +188,6 @@ void VvbModel::loadModel(const std::string modelFile)
             indices.push_back(uniqueVertices[vertex]);
         }
     }
-    createVertexBuffer(vertices);
-    createIndexBuffer(indices);
+    createVertexBuffer(vertices, uploads);
+    createIndexBuffer(indices, uploads);
 }
@@ -10,10 +10,10 @@
 
 
 
-VvbPipeline::VvbPipeline(VvbDevice& vvbDevice, VkPipelineLayout pipelineLayout, VkRenderPass renderPass, const std::string& vertexFilepath, const std::string& fragmentFilepath, Primitive primitive)
+VvbPipeline::VvbPipeline(VvbDevice& vvbDevice, VkPipelineLayout pipelineLayout, VkRenderPass renderPass, const std::string& vertexFilepath, const std::string& fragmentFilepath, Primitive primitive, VertexFormat vertexFormat)
 	: vvbDevice(vvbDevice)
 {
-	createGraphicsPipeline(pipelineLayout, renderPass, vertexFilepath, fragmentFilepath, primitive);
+	createGraphicsPipeline(pipelineLayout, renderPass, vertexFilepath, fragmentFilepath, primitive, vertexFormat);
 }
 
 VvbPipeline::~VvbPipeline()
@@ -27,7 +27,7 @@ void VvbPipeline::bind(VkCommandBuffer commandBuffer)
 	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
 }
 
-void VvbPipeline::createGraphicsPipeline(VkPipelineLayout pipelineLayout, VkRenderPass renderPass, const std::string& vertexFilepath, const std::string& fragmentFilepath, Primitive primitive)
+void VvbPipeline::createGraphicsPipeline(VkPipelineLayout pipelineLayout, VkRenderPass renderPass, const std::string& vertexFilepath, const std::string& fragmentFilepath, Primitive primitive, VertexFormat vertexFormat)
 {
 
 	std::vector<char> vertexShaderCode = readFile(vertexFilepath);
@@ -58,8 +58,21 @@ void VvbPipeline::createGraphicsPipeline(VkPipelineLayout pipelineLayout, VkRend
 
 	std::vector<VkDynamicState> dynamicStates = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR, VK_DYNAMIC_STATE_LINE_WIDTH };
 
-	auto bindingDescription = VvbModel::Vertex::getBindingDescription();
-	auto attributeDescriptions = VvbModel::Vertex::getAttributeDescriptions();
+	VkVertexInputBindingDescription bindingDescription;
+	std::vector<VkVertexInputAttributeDescription> attributeDescriptions;
+
+	if (vertexFormat == VertexFormat::Packed)
+	{
+		auto packedAttributes = PackedVertex::getAttributeDescriptions();
+		bindingDescription = PackedVertex::getBindingDescription();
+		attributeDescriptions.assign(packedAttributes.begin(), packedAttributes.end());
+	}
+	else
+	{
+		auto standardAttributes = VvbModel::Vertex::getAttributeDescriptions();
+		bindingDescription = VvbModel::Vertex::getBindingDescription();
+		attributeDescriptions.assign(standardAttributes.begin(), standardAttributes.end());
+	}
 
 	VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
 	vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
@@ -34,6 +34,9 @@ VkCommandBuffer VvbRenderer::beginFrame()
 	
 	isFrameStarted = true;
 
+	// the fence of the frame signaled in aquireNextImage, its staging partition can be reused
+	vvbDevice.beginFrame(getCurrentFrame());
+
 	VkCommandBuffer commandBuffer = getCurrentCommandBuffer();
 	VkCommandBufferBeginInfo beginInfo{};
 	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
@@ -0,0 +1,55 @@
+// vulkan base
+#include "vvb_staging_buffer.hpp"
+#include "vvb_device.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+
+VvbStagingBuffer::VvbStagingBuffer(VvbDevice& vvbDevice, uint32_t partitionCount, VkDeviceSize partitionSize)
+	: vvbDevice(vvbDevice), partitionSize(partitionSize), partitionCount(partitionCount)
+{
+	assert(partitionCount > 0 && "staging buffer needs a partition per frame in flight");
+
+	vvbDevice.createBuffer(partitionSize * partitionCount, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, buffer, memory);
+
+	if (memory.mapped == nullptr)
+		throw std::runtime_error("failed to map staging buffer!");
+}
+
+VvbStagingBuffer::~VvbStagingBuffer()
+{
+	vvbDevice.destroyBuffer(buffer, memory);
+}
+
+void VvbStagingBuffer::beginFrame(uint32_t frameIndex)
+{
+	assert(frameIndex < partitionCount && "no staging partition for this frame");
+
+	currentPartition = frameIndex;
+	head = 0;
+}
+
+VvbStagingBuffer::Region VvbStagingBuffer::allocate(VkDeviceSize size, VkDeviceSize alignment)
+{
+	assert(alignment > 0 && (alignment & (alignment - 1)) == 0 && "alignment must be a power of two");
+
+	VkDeviceSize offset = (head + alignment - 1) & ~(alignment - 1);
+	if (offset + size > partitionSize)
+	{
+		stats.overflows++;
+		return Region();
+	}
+
+	head = offset + size;
+	stats.allocations++;
+	stats.peakPartitionUsage = std::max(stats.peakPartitionUsage, head);
+
+	Region region;
+	region.buffer = buffer;
+	region.offset = currentPartition * partitionSize + offset;
+	region.size = size;
+	region.mapped = static_cast<char*>(memory.mapped) + region.offset;
+	return region;
+}
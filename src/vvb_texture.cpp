@@ -49,25 +49,13 @@ void VvbTexture::createTextureImage(const std::string& textureFilePath)
 	if (!pixels)
 		throw std::runtime_error("failed to load texture image : " + textureFilePath);
 
-	VvbBuffer stvvbingBuffer{
-		device,
-		imageSize,
-		4,
-		VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
-	};
-
-	stvvbingBuffer.map();
-	stvvbingBuffer.write(pixels);
-	stvvbingBuffer.unmap();
-
-	stbi_image_free(pixels);
-
 	device.createImage(texWidth, texHeight, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, textureImage, textureImageMemory, mipLevels, VK_SAMPLE_COUNT_1_BIT);
 
 	device.transitionImageLayout(textureImage, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, mipLevels);
 
-	device.copyBufferToImage(stvvbingBuffer.getBuffer(), textureImage, texWidth, texHeight);
+	// 4 bytes per texel
+	device.uploadToImage(pixels, imageSize * 4, textureImage, texWidth, texHeight);
+	stbi_image_free(pixels);
 
 	//device.transitionImageLayout(textureImage, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, mipLevels);
 
@@ -76,26 +64,14 @@ void VvbTexture::createTextureImage(const std::string& textureFilePath)
 
 void VvbTexture::createTextureImage()
 {
-	VvbBuffer stvvbingBuffer{
-		device,
-		1,
-		4,
-		VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
-	};
-
-	unsigned long textureColor = 0x00FFFFFF;
+	uint32_t textureColor = 0x00FFFFFF;
 	mipLevels = 1;
 
-	stvvbingBuffer.map();
-	stvvbingBuffer.write(&textureColor);
-	stvvbingBuffer.unmap();
-
 	device.createImage(1, 1, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, textureImage, textureImageMemory, mipLevels, VK_SAMPLE_COUNT_1_BIT);
 
 	device.transitionImageLayout(textureImage, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, mipLevels);
 
-	device.copyBufferToImage(stvvbingBuffer.getBuffer(), textureImage, 1, 1);
+	device.uploadToImage(&textureColor, sizeof(textureColor), textureImage, 1, 1);
 
 	//device.transitionImageLayout(textureImage, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, mipLevels);
 
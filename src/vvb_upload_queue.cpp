@@ -0,0 +1,328 @@
+// vulkan base
+#include "vvb_upload_queue.hpp"
+#include "vvb_device.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <stdexcept>
+
+// the stages and accesses of the graphics queue reading the uploaded buffers
+static const VkPipelineStageFlags ReadStages = VK_PIPELINE_STAGE_VERTEX_INPUT_BIT;
+static const VkAccessFlags ReadAccesses = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT;
+
+VvbUploadQueue::VvbUploadQueue(VvbDevice& vvbDevice, VvbStagingBuffer& stagingBuffer)
+	: vvbDevice(vvbDevice), stagingBuffer(stagingBuffer)
+{
+	isOwnershipTransferred = vvbDevice.getQueueFamilyIndices().isGraphicsTransferQueueConcurent();
+}
+
+VvbUploadQueue::~VvbUploadQueue()
+{
+	VkDevice device = vvbDevice.getDevice();
+
+	for (Batch& batch : batches)
+	{
+		vkWaitForFences(device, 1, &batch.fence, VK_TRUE, UINT64_MAX);
+		recycleBatch(batch);
+		freeBatches.push_back(std::move(batch));
+	}
+	batches.clear();
+
+	for (std::pair<VkBuffer, VvbMemoryAllocator::Allocation>& temporaryBuffer : temporaryBuffers)
+		vvbDevice.destroyBuffer(temporaryBuffer.first, temporaryBuffer.second);
+
+	for (Batch& batch : freeBatches)
+	{
+		vkFreeCommandBuffers(device, vvbDevice.getTransferCommandPool(), 1, &batch.transferCommandBuffer);
+		if (batch.graphicsCommandBuffer != VK_NULL_HANDLE)
+			vkFreeCommandBuffers(device, vvbDevice.getGraphicsCommandPool(), 1, &batch.graphicsCommandBuffer);
+		vkDestroyFence(device, batch.fence, nullptr);
+	}
+}
+
+void VvbUploadQueue::upload(const void* data, VkDeviceSize size, VkBuffer dstBuffer, VkDeviceSize dstOffset)
+{
+	if (size == 0)
+		return;
+
+	Copy copy{ VK_NULL_HANDLE, dstBuffer, { 0, dstOffset, size } };
+
+	VvbStagingBuffer::Region region = stagingBuffer.allocate(size);
+	if (region.isValid())
+	{
+		std::memcpy(region.mapped, data, size);
+		copy.srcBuffer = region.buffer;
+		copy.region.srcOffset = region.offset;
+		stagingFrames |= 1u << stagingBuffer.getCurrentFrame();
+	}
+	else
+	{
+		// the partition of the frame is full, the upload gets a buffer of its own until its batch is done
+		VvbMemoryAllocator::Allocation memory;
+		vvbDevice.createBuffer(size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, copy.srcBuffer, memory);
+		std::memcpy(memory.mapped, data, size);
+		temporaryBuffers.emplace_back(copy.srcBuffer, memory);
+	}
+
+	copies.push_back(copy);
+}
+
+uint64_t VvbUploadQueue::submit()
+{
+	if (copies.empty())
+		return nextTicket - 1;
+
+	Batch batch;
+	if (freeBatches.empty())
+	{
+		batch = createBatch();
+	}
+	else
+	{
+		batch = std::move(freeBatches.back());
+		freeBatches.pop_back();
+	}
+
+	batch.ticket = nextTicket++;
+	batch.state = BatchState::transferring;
+	batch.stagingFrames = stagingFrames;
+	batch.copies.swap(copies);
+	batch.temporaryBuffers.swap(temporaryBuffers);
+	stagingFrames = 0;
+
+	recordTransfer(batch);
+
+	VkSubmitInfo submitInfo{};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &batch.transferCommandBuffer;
+
+	vkResetFences(vvbDevice.getDevice(), 1, &batch.fence);
+	if (vkQueueSubmit(vvbDevice.getTransferQueue(), 1, &submitInfo, batch.fence) != VK_SUCCESS)
+		throw std::runtime_error("failed to submit upload batch!");
+
+	uint64_t ticket = batch.ticket;
+	batches.push_back(std::move(batch));
+	return ticket;
+}
+
+void VvbUploadQueue::update()
+{
+	while (!batches.empty())
+	{
+		Batch& batch = batches.front();
+		if (vkGetFenceStatus(vvbDevice.getDevice(), batch.fence) != VK_SUCCESS)
+			break;
+
+		if (batch.state == BatchState::transferring && isOwnershipTransferred)
+		{
+			recordAcquire(batch);
+
+			VkSubmitInfo submitInfo{};
+			submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+			submitInfo.commandBufferCount = 1;
+			submitInfo.pCommandBuffers = &batch.graphicsCommandBuffer;
+
+			vkResetFences(vvbDevice.getDevice(), 1, &batch.fence);
+			if (vkQueueSubmit(vvbDevice.getGraphicsQueue(), 1, &submitInfo, batch.fence) != VK_SUCCESS)
+				throw std::runtime_error("failed to submit upload acquire!");
+
+			// the frames submitted from now on come after the acquire on the graphics queue
+			batch.state = BatchState::acquiring;
+			completedTicket = std::max(completedTicket, batch.ticket);
+			continue;
+		}
+
+		completedTicket = std::max(completedTicket, batch.ticket);
+		recycleBatch(batch);
+		freeBatches.push_back(std::move(batch));
+		batches.pop_front();
+	}
+}
+
+void VvbUploadQueue::wait(uint64_t ticket)
+{
+	assert(ticket < nextTicket && "waiting for uploads that were not submitted");
+
+	while (!isComplete(ticket) && !batches.empty())
+	{
+		vkWaitForFences(vvbDevice.getDevice(), 1, &batches.front().fence, VK_TRUE, UINT64_MAX);
+		update();
+	}
+}
+
+void VvbUploadQueue::waitForFrame(uint32_t frameIndex)
+{
+	// usually done long ago, the partition was used MAX_FRAMES_IN_FLIGHT frames back
+	for (Batch& batch : batches)
+	{
+		if (batch.state == BatchState::transferring && (batch.stagingFrames & (1u << frameIndex)))
+			vkWaitForFences(vvbDevice.getDevice(), 1, &batch.fence, VK_TRUE, UINT64_MAX);
+	}
+
+	// copies recorded from the partition and never submitted
+	if (stagingFrames & (1u << frameIndex))
+		wait(submit());
+
+	update();
+}
+
+VvbUploadQueue::Batch VvbUploadQueue::createBatch()
+{
+	Batch batch;
+
+	VkCommandBufferAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	allocInfo.pNext = VK_NULL_HANDLE; // optional
+	allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	allocInfo.commandPool = vvbDevice.getTransferCommandPool();
+	allocInfo.commandBufferCount = 1;
+
+	if (vkAllocateCommandBuffers(vvbDevice.getDevice(), &allocInfo, &batch.transferCommandBuffer) != VK_SUCCESS)
+		throw std::runtime_error("failed to allocate upload command buffer!");
+
+	if (isOwnershipTransferred)
+	{
+		allocInfo.commandPool = vvbDevice.getGraphicsCommandPool();
+		if (vkAllocateCommandBuffers(vvbDevice.getDevice(), &allocInfo, &batch.graphicsCommandBuffer) != VK_SUCCESS)
+			throw std::runtime_error("failed to allocate upload command buffer!");
+	}
+
+	VkFenceCreateInfo fenceInfo{};
+	fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+	fenceInfo.pNext = VK_NULL_HANDLE; // optional
+	fenceInfo.flags = 0; // optional
+
+	if (vkCreateFence(vvbDevice.getDevice(), &fenceInfo, nullptr, &batch.fence) != VK_SUCCESS)
+		throw std::runtime_error("failed to create upload fence!");
+
+	return batch;
+}
+
+void VvbUploadQueue::recordTransfer(Batch& batch)
+{
+	VkCommandBufferBeginInfo beginInfo{};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.pNext = VK_NULL_HANDLE; // optional
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	beginInfo.pInheritanceInfo = VK_NULL_HANDLE; // optional
+
+	VkCommandBuffer commandBuffer = batch.transferCommandBuffer;
+	vkBeginCommandBuffer(commandBuffer, &beginInfo);
+
+	// a batch still running may write the same ranges (a section patched twice in a row)
+	VkMemoryBarrier memoryBarrier{};
+	memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	memoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	memoryBarrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
+
+	// one copy command per pair of buffers
+	std::sort(batch.copies.begin(), batch.copies.end(), [](const Copy& a, const Copy& b) {
+		return a.srcBuffer != b.srcBuffer ? a.srcBuffer < b.srcBuffer : a.dstBuffer < b.dstBuffer;
+	});
+
+	for (size_t first = 0; first < batch.copies.size();)
+	{
+		regions.clear();
+		size_t last = first;
+		for (; last < batch.copies.size() && batch.copies[last].srcBuffer == batch.copies[first].srcBuffer && batch.copies[last].dstBuffer == batch.copies[first].dstBuffer; last++)
+			regions.push_back(batch.copies[last].region);
+
+		vkCmdCopyBuffer(commandBuffer, batch.copies[first].srcBuffer, batch.copies[first].dstBuffer, static_cast<uint32_t>(regions.size()), regions.data());
+		first = last;
+	}
+
+	// the ranges go to the graphics family, or are made visible to the vertex input when it is the same
+	if (isOwnershipTransferred)
+	{
+		VvbDevice::QueueFamilyIndices indices = vvbDevice.getQueueFamilyIndices();
+		collectBarriers(batch, VK_ACCESS_TRANSFER_WRITE_BIT, 0, indices.transferFamily.value(), indices.graphicsFamily.value());
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, static_cast<uint32_t>(barriers.size()), barriers.data(), 0, nullptr);
+	}
+	else
+	{
+		collectBarriers(batch, VK_ACCESS_TRANSFER_WRITE_BIT, ReadAccesses, VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED);
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, ReadStages, 0, 0, nullptr, static_cast<uint32_t>(barriers.size()), barriers.data(), 0, nullptr);
+	}
+
+	if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS)
+		throw std::runtime_error("failed to record upload command buffer!");
+}
+
+void VvbUploadQueue::recordAcquire(Batch& batch)
+{
+	VkCommandBufferBeginInfo beginInfo{};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.pNext = VK_NULL_HANDLE; // optional
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	beginInfo.pInheritanceInfo = VK_NULL_HANDLE; // optional
+
+	VkCommandBuffer commandBuffer = batch.graphicsCommandBuffer;
+	vkBeginCommandBuffer(commandBuffer, &beginInfo);
+
+	// same ranges and families as the release, the transfer already finished so nothing to wait on
+	VvbDevice::QueueFamilyIndices indices = vvbDevice.getQueueFamilyIndices();
+	collectBarriers(batch, 0, ReadAccesses, indices.transferFamily.value(), indices.graphicsFamily.value());
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, ReadStages, 0, 0, nullptr, static_cast<uint32_t>(barriers.size()), barriers.data(), 0, nullptr);
+
+	if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS)
+		throw std::runtime_error("failed to record upload acquire command buffer!");
+}
+
+void VvbUploadQueue::recycleBatch(Batch& batch)
+{
+	for (std::pair<VkBuffer, VvbMemoryAllocator::Allocation>& temporaryBuffer : batch.temporaryBuffers)
+		vvbDevice.destroyBuffer(temporaryBuffer.first, temporaryBuffer.second);
+
+	batch.temporaryBuffers.clear();
+	batch.copies.clear();
+}
+
+void VvbUploadQueue::collectBarriers(const Batch& batch, VkAccessFlags srcAccessMask, VkAccessFlags dstAccessMask, uint32_t srcQueueFamily, uint32_t dstQueueFamily)
+{
+	barriers.clear();
+	for (const Copy& copy : batch.copies)
+	{
+		VkBufferMemoryBarrier barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+		barrier.pNext = VK_NULL_HANDLE; // optional
+		barrier.srcAccessMask = srcAccessMask;
+		barrier.dstAccessMask = dstAccessMask;
+		barrier.srcQueueFamilyIndex = srcQueueFamily;
+		barrier.dstQueueFamilyIndex = dstQueueFamily;
+		barrier.buffer = copy.dstBuffer;
+		barrier.offset = copy.region.dstOffset;
+		barrier.size = copy.region.size;
+		barriers.push_back(barrier);
+	}
+}
+
+VvbUploadBatch::VvbUploadBatch(VvbDevice& vvbDevice)
+	: uploadQueue(vvbDevice.getUploadQueue())
+{
+}
+
+VvbUploadBatch::~VvbUploadBatch()
+{
+	submit();
+}
+
+void VvbUploadBatch::upload(const void* data, VkDeviceSize size, VkBuffer dstBuffer, VkDeviceSize dstOffset)
+{
+	uploadQueue.upload(data, size, dstBuffer, dstOffset);
+	copyCount++;
+	isSubmitted = false;
+}
+
+void VvbUploadBatch::submit()
+{
+	if (isSubmitted)
+		return;
+
+	// the upload queue may hold copies recorded before the batch, they only go out sooner
+	uploadQueue.wait(uploadQueue.submit());
+	isSubmitted = true;
+}